@@ -0,0 +1,302 @@
+#include "Allocations.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <malloc.h>
+#include <new>
+#include <ostream>
+
+namespace
+{
+    struct Counters
+    {
+        // Set by tag() while tags() may be reading it.
+        std::atomic<const char*> name{""};
+        std::atomic<std::uint64_t> entries{0};
+        std::atomic<std::uint64_t> allocations{0};
+        std::atomic<std::uint64_t> frees{0};
+        std::atomic<std::uint64_t> bytesAllocated{0};
+        std::atomic<std::uint64_t> bytesFreed{0};
+        std::atomic<std::uint64_t> peak{0};
+        std::atomic<std::int64_t> live{0};
+    };
+
+    struct ThreadState
+    {
+        Counters* counters{nullptr};
+        // Only the overflow slot has more than one writer; the others are updated without locked instructions.
+        bool shared{false};
+        Allocations::Scope* scope{nullptr};
+    };
+
+    std::atomic<bool> accounting{false};
+    std::array<Counters,Allocations::MaxTags> tagCounters;
+    std::atomic<std::size_t> tagCount{0};
+    // The last slot is shared by any threads beyond the limit and by threads that are exiting.
+    std::array<Counters,Allocations::MaxThreads> threadCounters;
+    std::atomic<std::size_t> threadCount{0};
+    // Bit i is set while slot i is free for the next new thread; the shared slot is never released.
+    std::atomic<std::uint64_t> freeSlots{0};
+    static_assert(Allocations::MaxThreads <= 64);
+    Counters totalCounters;
+    constinit thread_local ThreadState threadState;
+
+    void raise(std::atomic<std::uint64_t>& peak, std::int64_t value)
+    {
+        if(value <= 0)
+            return;
+        auto current{peak.load(std::memory_order_relaxed)};
+        while(current < static_cast<std::uint64_t>(value) && !peak.compare_exchange_weak(current,value,std::memory_order_relaxed)) {}
+    }
+
+    // Hands the thread's slot back when it exits. Later thread_local destructors may still allocate, so the
+    // thread moves to the shared slot rather than keep writing to one another thread may now own.
+    struct SlotOwner
+    {
+        ~SlotOwner()
+        {
+            const auto slot{static_cast<std::size_t>(threadState.counters-threadCounters.data())};
+            threadState.counters = &threadCounters.back();
+            threadState.shared = true;
+            freeSlots.fetch_or(std::uint64_t{1} << slot,std::memory_order_release);
+        }
+    };
+
+    // Lowest released slot, or a new one; a slot's counters carry over from the threads that held it before.
+    std::size_t takeSlot()
+    {
+        auto free{freeSlots.load(std::memory_order_relaxed)};
+        while(free && !freeSlots.compare_exchange_weak(free,free & (free-1),std::memory_order_acquire,std::memory_order_relaxed)) {}
+        if(free)
+            return std::countr_zero(free);
+        return std::min(threadCount.fetch_add(1,std::memory_order_relaxed),Allocations::MaxThreads-1);
+    }
+
+    Counters& threadCountersOf(ThreadState& state)
+    {
+        if(!state.counters)
+        {
+            const auto slot{takeSlot()};
+            state.counters = &threadCounters[slot];
+            state.shared = slot == Allocations::MaxThreads-1;
+            if(!state.shared)
+                thread_local const SlotOwner owner;
+        }
+        return *state.counters;
+    }
+
+    template<class T>
+    T add(std::atomic<T>& counter, T value, bool shared)
+    {
+        if(shared)
+            return counter.fetch_add(value,std::memory_order_relaxed)+value;
+        const auto result{counter.load(std::memory_order_relaxed)+value};
+        counter.store(result,std::memory_order_relaxed);
+        return result;
+    }
+
+    // Returns the live bytes after the change.
+    std::int64_t count(Counters& counters, std::int64_t bytes, bool shared)
+    {
+        if(bytes > 0)
+        {
+            add<std::uint64_t>(counters.allocations,1,shared);
+            add<std::uint64_t>(counters.bytesAllocated,bytes,shared);
+        }
+        else
+        {
+            add<std::uint64_t>(counters.frees,1,shared);
+            add<std::uint64_t>(counters.bytesFreed,-bytes,shared);
+        }
+        return add<std::int64_t>(counters.live,bytes,shared);
+    }
+
+    Allocations::Stats snapshot(const Counters& counters, const char* name)
+    {
+        return {name,
+            counters.entries.load(std::memory_order_relaxed),
+            counters.allocations.load(std::memory_order_relaxed),
+            counters.frees.load(std::memory_order_relaxed),
+            counters.bytesAllocated.load(std::memory_order_relaxed),
+            counters.bytesFreed.load(std::memory_order_relaxed),
+            counters.peak.load(std::memory_order_relaxed),
+            counters.live.load(std::memory_order_relaxed)};
+    }
+
+    void clear(Counters& counters, std::uint64_t peak)
+    {
+        counters.entries = 0;
+        counters.allocations = 0;
+        counters.frees = 0;
+        counters.bytesAllocated = 0;
+        counters.bytesFreed = 0;
+        counters.peak = peak;
+    }
+
+    std::uint64_t liveBytes(const Counters& counters)
+    {
+        return static_cast<std::uint64_t>(std::max<std::int64_t>(counters.live.load(),0));
+    }
+
+    void* allocate(std::size_t size)
+    {
+        for(;;)
+        {
+            if(auto p{std::malloc(size ? size : 1)})
+            {
+                if(accounting.load(std::memory_order_relaxed))
+                    Allocations::onAllocate(malloc_usable_size(p));
+                return p;
+            }
+            const auto handler{std::get_new_handler()};
+            if(!handler)
+                throw std::bad_alloc{};
+            handler();
+        }
+    }
+
+    void deallocate(void* p)
+    {
+        if(p && accounting.load(std::memory_order_relaxed))
+            Allocations::onFree(malloc_usable_size(p));
+        std::free(p);
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { deallocate(p); }
+
+void Allocations::enable(bool on)
+{
+    accounting.store(on,std::memory_order_relaxed);
+}
+
+bool Allocations::enabled()
+{
+    return accounting.load(std::memory_order_relaxed);
+}
+
+Allocations::TagId Allocations::tag(const char* name)
+{
+    const auto id{std::min(tagCount.fetch_add(1,std::memory_order_relaxed),MaxTags-1)};
+    tagCounters[id].name.store(id == MaxTags-1 ? "(other)" : name,std::memory_order_release);
+    return static_cast<TagId>(id);
+}
+
+Allocations::Scope::Scope(TagId tag) :
+    m_tag{tag},
+    m_parent{threadState.scope},
+    m_entryLive{threadCountersOf(threadState).live.load(std::memory_order_relaxed)}
+{
+    tagCounters[m_tag].entries.fetch_add(1,std::memory_order_relaxed);
+    threadState.scope = this;
+}
+
+Allocations::Scope::~Scope()
+{
+    raise(tagCounters[m_tag].peak,m_peak);
+    if(m_parent)
+        m_parent->m_peak = std::max(m_parent->m_peak,m_entryLive-m_parent->m_entryLive+m_peak);
+    threadState.scope = m_parent;
+}
+
+void Allocations::onAllocate(std::size_t bytes)
+{
+    auto& state{threadState};
+    auto& counters{threadCountersOf(state)};
+    const auto live{count(counters,static_cast<std::int64_t>(bytes),state.shared)};
+    if(live > static_cast<std::int64_t>(counters.peak.load(std::memory_order_relaxed)))
+        raise(counters.peak,live);
+    raise(totalCounters.peak,totalCounters.live.fetch_add(bytes,std::memory_order_relaxed)+bytes);
+    if(const auto scope{state.scope})
+    {
+        count(tagCounters[scope->m_tag],static_cast<std::int64_t>(bytes),true);
+        scope->m_peak = std::max(scope->m_peak,live-scope->m_entryLive);
+    }
+}
+
+void Allocations::onFree(std::size_t bytes)
+{
+    auto& state{threadState};
+    count(threadCountersOf(state),-static_cast<std::int64_t>(bytes),state.shared);
+    totalCounters.live.fetch_sub(bytes,std::memory_order_relaxed);
+    if(const auto scope{state.scope})
+        count(tagCounters[scope->m_tag],-static_cast<std::int64_t>(bytes),true);
+}
+
+std::vector<Allocations::Stats> Allocations::tags()
+{
+    std::vector<Stats> stats;
+    const auto count{std::min(tagCount.load(),MaxTags)};
+    for(std::size_t i=0; i<count; ++i)
+        stats.push_back(snapshot(tagCounters[i],tagCounters[i].name.load(std::memory_order_acquire)));
+    return stats;
+}
+
+std::vector<Allocations::Stats> Allocations::threads()
+{
+    // One name per slot; the last slot is shared by threads beyond the limit and by exiting ones.
+    static const auto names{[]{
+        std::array<std::array<char,16>,MaxThreads> names{};
+        for(std::size_t i=0; i<MaxThreads; ++i)
+            std::snprintf(names[i].data(),names[i].size(),i == MaxThreads-1 ? "(other)" : "thread %zu",i+1);
+        return names;
+    }()};
+    std::vector<Stats> stats;
+    const auto count{std::min(threadCount.load(),MaxThreads)};
+    for(std::size_t i=0; i<count; ++i)
+        stats.push_back(snapshot(threadCounters[i],names[i].data()));
+    const auto& other{threadCounters.back()};
+    if(count < MaxThreads && (other.allocations.load(std::memory_order_relaxed) || other.frees.load(std::memory_order_relaxed)))
+        stats.push_back(snapshot(other,names.back().data()));
+    return stats;
+}
+
+Allocations::Stats Allocations::total()
+{
+    auto total{snapshot(totalCounters,"total")};
+    for(const auto& stats : threads())
+    {
+        total.allocations += stats.allocations;
+        total.frees += stats.frees;
+        total.bytesAllocated += stats.bytesAllocated;
+        total.bytesFreed += stats.bytesFreed;
+    }
+    return total;
+}
+
+void Allocations::reset()
+{
+    for(auto& counters : tagCounters)
+        clear(counters,0);
+    for(auto& counters : threadCounters)
+        clear(counters,liveBytes(counters));
+    clear(totalCounters,liveBytes(totalCounters));
+}
+
+void Allocations::report(std::ostream& os)
+{
+    const auto row{[&os](const Stats& stats){
+        char line[128];
+        std::snprintf(line,sizeof(line),"%-18s %8llu %10llu %10llu %14llu %12lld %12llu",stats.name,
+            static_cast<unsigned long long>(stats.entries),static_cast<unsigned long long>(stats.allocations),
+            static_cast<unsigned long long>(stats.frees),static_cast<unsigned long long>(stats.bytesAllocated),
+            static_cast<long long>(stats.live),static_cast<unsigned long long>(stats.peak));
+        os << line << '\n';
+    }};
+    char header[128];
+    std::snprintf(header,sizeof(header),"%-18s %8s %10s %10s %14s %12s %12s","ALLOCATIONS","ENTRIES","ALLOCS","FREES","BYTES","LIVE","PEAK");
+    os << header << '\n';
+    row(total());
+    for(const auto& stats : threads())
+        row(stats);
+    for(const auto& stats : tags())
+        row(stats);
+    os.flush();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+/*
+Opt-in heap accounting. Global operator new and delete are replaced in
+Allocations.cpp; while accounting is off they cost one relaxed load
+beyond malloc and free. When on, every allocation and free is counted
+for the calling thread and for the innermost tagged scope active on it,
+along with live bytes and their peak. Bytes are the usable size malloc
+reports for the block. Nothing here allocates, so the counters can be
+updated from inside operator new. Threads are counted in slots that are
+handed back on exit, so a row accumulates every thread that held it.
+*/
+namespace Allocations
+{
+    using TagId = std::uint16_t;
+    constexpr std::size_t MaxTags{64};
+    constexpr std::size_t MaxThreads{64};
+
+    struct Stats
+    {
+        const char* name{""};
+        std::uint64_t entries{};
+        std::uint64_t allocations{};
+        std::uint64_t frees{};
+        std::uint64_t bytesAllocated{};
+        std::uint64_t bytesFreed{};
+        std::uint64_t peak{};
+        std::int64_t live{};
+    };
+
+    void enable(bool on);
+    bool enabled();
+    // Registers a scope name; names must outlive the program, like string literals.
+    TagId tag(const char* name);
+
+    // Attributes the thread's allocations to tag until destroyed; peak is the most live bytes above the level at entry.
+    class Scope
+    {
+        TagId m_tag;
+        Scope* m_parent;
+        std::int64_t m_entryLive;
+        std::int64_t m_peak{0};
+        friend void onAllocate(std::size_t bytes);
+        friend void onFree(std::size_t bytes);
+    public:
+        explicit Scope(TagId tag);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    void onAllocate(std::size_t bytes);
+    void onFree(std::size_t bytes);
+
+    // Snapshots since the last reset(); live bytes are kept across resets. A tag's peak is the largest
+    // rise in its thread's live bytes during any one scope, nested scopes included.
+    std::vector<Stats> tags();
+    std::vector<Stats> threads();
+    Stats total();
+    void reset();
+    // Plain text tables of the totals, threads and tags.
+    void report(std::ostream& os);
+}
+
+#define ALLOCATION_CONCAT_IMPL(a,b) a##b
+#define ALLOCATION_CONCAT(a,b) ALLOCATION_CONCAT_IMPL(a,b)
+#define ALLOCATION_SCOPE(name) \
+    static const auto ALLOCATION_CONCAT(allocationTag,__LINE__){Allocations::tag(name)}; \
+    const Allocations::Scope ALLOCATION_CONCAT(allocationScope,__LINE__){ALLOCATION_CONCAT(allocationTag,__LINE__)}
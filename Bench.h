@@ -0,0 +1,173 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Bench
+{
+    template<class T>
+    inline void doNotOptimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Hardware cache misses of the calling thread; unavailable without perf_event_open permission.
+    class CacheMisses
+    {
+        int m_fd{-1};
+    public:
+        CacheMisses()
+        {
+#ifdef __linux__
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            m_fd = static_cast<int>(syscall(SYS_perf_event_open,&attr,0,-1,-1,0));
+#endif
+        }
+        ~CacheMisses()
+        {
+#ifdef __linux__
+            if(m_fd >= 0)
+                close(m_fd);
+#endif
+        }
+        CacheMisses(const CacheMisses&) = delete;
+        CacheMisses& operator=(const CacheMisses&) = delete;
+
+        bool available() const { return m_fd >= 0; }
+
+        void start()
+        {
+#ifdef __linux__
+            if(!available())
+                return;
+            ioctl(m_fd,PERF_EVENT_IOC_RESET,0);
+            ioctl(m_fd,PERF_EVENT_IOC_ENABLE,0);
+#endif
+        }
+
+        long long stop()
+        {
+            long long count{-1};
+#ifdef __linux__
+            if(!available())
+                return count;
+            ioctl(m_fd,PERF_EVENT_IOC_DISABLE,0);
+            if(read(m_fd,&count,sizeof(count)) != sizeof(count))
+                count = -1;
+#endif
+            return count;
+        }
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::size_t ops{};
+        double nsPerOp{};
+        double missesPerOp{-1};
+    };
+
+    // Runs fcn until at least minTime has passed; fcn returns the number of operations it performed.
+    template<class F>
+    Result run(const std::string& name, F&& fcn, std::chrono::milliseconds minTime = std::chrono::milliseconds{200})
+    {
+        static CacheMisses misses;
+        std::size_t ops{0};
+        misses.start();
+        const auto start{std::chrono::steady_clock::now()};
+        auto elapsed{std::chrono::steady_clock::duration{}};
+        while(elapsed < minTime)
+        {
+            ops += fcn();
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+        const auto missCount{misses.stop()};
+        const std::chrono::duration<double,std::nano> ns{elapsed};
+        return {name, ops, ns.count()/ops, missCount < 0 ? -1.0 : static_cast<double>(missCount)/ops};
+    }
+
+    // Every result printed so far, in order.
+    inline std::vector<Result>& results()
+    {
+        static std::vector<Result> instance;
+        return instance;
+    }
+
+    inline void print(const Result& result)
+    {
+        results().push_back(result);
+        std::cout << std::left << std::setw(48) << result.name
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(2) << result.nsPerOp << " ns/op"
+                  << std::setw(14) << result.ops << " ops";
+        if(result.missesPerOp >= 0)
+            std::cout << std::setw(12) << std::setprecision(3) << result.missesPerOp << " misses/op";
+        std::cout << std::endl;
+    }
+
+    // Quotes text as a JSON string, escaping quotes, backslashes and control characters.
+    inline std::string jsonString(const std::string& text)
+    {
+        std::string quoted{"\""};
+        for(const auto c : text)
+        {
+            if(c == '"' || c == '\\')
+            {
+                quoted += '\\';
+                quoted += c;
+            }
+            else if(static_cast<unsigned char>(c) < 0x20)
+            {
+                char escape[7];
+                std::snprintf(escape,sizeof(escape),"\\u%04x",static_cast<unsigned>(c));
+                quoted += escape;
+            }
+            else
+                quoted += c;
+        }
+        return quoted += '"';
+    }
+
+    // {"benchmarks":[{"name":...,"ops":...,"ns_per_op":...,"misses_per_op":...}]}; misses are null when unavailable.
+    inline bool writeJson(const std::string& fileName)
+    {
+        auto file{std::fstream{fileName,std::ios_base::out | std::ios_base::trunc}};
+        if(!file)
+            return false;
+        file << std::fixed << std::setprecision(3) << "{\"benchmarks\":[";
+        auto first{true};
+        for(const auto& result : results())
+        {
+            file << (first ? "\n" : ",\n")
+                 << "{\"name\":" << jsonString(result.name)
+                 << ",\"ops\":" << result.ops
+                 << ",\"ns_per_op\":" << result.nsPerOp
+                 << ",\"misses_per_op\":";
+            if(result.missesPerOp >= 0)
+                file << result.missesPerOp;
+            else
+                file << "null";
+            file << "}";
+            first = false;
+        }
+        file << "\n]}\n";
+        file.close();
+        return true;
+    }
+}
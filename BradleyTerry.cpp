@@ -0,0 +1,128 @@
+#include "BradleyTerry.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <barrier>
+#include <cmath>
+
+BradleyTerry::BradleyTerry(std::size_t count, const std::vector<Records::Comparison>& comparisons) :
+    m_rowStart(count+1,0),
+    m_strength(count,1.0)
+{
+    PROFILE_ZONE("bradleyTerry.build");
+    const auto valid{[count](const Records::Comparison& comparison){
+        return comparison.winner < count && comparison.loser < count && comparison.winner != comparison.loser;
+    }};
+    // Counting sort of both directions of every game into rows, then duplicates within a row merged into counts.
+    // The top bit of an opponent marks a loss while the rows are being sorted.
+    constexpr MovieId Lost{MovieId{1} << 31};
+    for(const auto& comparison : comparisons)
+        if(valid(comparison))
+        {
+            ++m_rowStart[comparison.winner+1];
+            ++m_rowStart[comparison.loser+1];
+        }
+    for(std::size_t i=0; i<count; ++i)
+        m_rowStart[i+1] += m_rowStart[i];
+    m_opponents.resize(m_rowStart[count]);
+    {
+        auto fill{m_rowStart};
+        for(const auto& comparison : comparisons)
+            if(valid(comparison))
+            {
+                m_opponents[fill[comparison.winner]++] = comparison.loser;
+                m_opponents[fill[comparison.loser]++] = comparison.winner | Lost;
+            }
+    }
+    m_won.resize(m_opponents.size());
+    m_lost.resize(m_opponents.size());
+    std::size_t out{0};
+    for(std::size_t i=0; i<count; ++i)
+    {
+        const auto first{m_opponents.begin()+m_rowStart[i]};
+        const auto last{m_opponents.begin()+m_rowStart[i+1]};
+        const auto opponent{[](MovieId id){ return id & ~Lost; }};
+        std::sort(first,last,[&opponent](MovieId a, MovieId b){ return opponent(a) < opponent(b); });
+        m_rowStart[i] = out;
+        for(auto it{first}; it!=last; ++out)
+        {
+            const auto id{opponent(*it)};
+            std::uint32_t won{0};
+            std::uint32_t lost{0};
+            for(; it!=last && opponent(*it) == id; ++it)
+                ++((*it & Lost) ? lost : won);
+            m_opponents[out] = id;
+            m_won[out] = won;
+            m_lost[out] = lost;
+        }
+    }
+    m_rowStart[count] = out;
+    for(auto* column : {&m_opponents,&m_won,&m_lost})
+    {
+        column->resize(out);
+        column->shrink_to_fit();
+    }
+}
+
+BradleyTerry::Result BradleyTerry::fit(const Options& options)
+{
+    PROFILE_ZONE("bradleyTerry.fit");
+    const auto count{m_strength.size()};
+    const auto threads{std::clamp<std::size_t>(options.threads,1,std::max<std::size_t>(count,1))};
+    // Row ranges with about the same number of entries each.
+    std::vector<std::size_t> bounds{0};
+    for(std::size_t t=1; t<threads; ++t)
+    {
+        const auto target{m_opponents.size()*t/threads};
+        bounds.push_back(std::max<std::size_t>(bounds.back(),std::lower_bound(m_rowStart.begin(),m_rowStart.end()-1,target)-m_rowStart.begin()));
+    }
+    bounds.push_back(count);
+
+    std::vector<double> next(count);
+    std::vector<double> changes(threads,0.0);
+    Result result;
+    auto done{count == 0 || options.maxIterations == 0};
+    // Runs once per iteration after every thread has written its rows.
+    const auto finish{[&]() noexcept {
+        m_strength.swap(next);
+        result.change = *std::max_element(changes.begin(),changes.end());
+        ++result.iterations;
+        result.converged = result.change <= options.tolerance;
+        done = result.converged || result.iterations >= options.maxIterations;
+    }};
+    std::barrier sync{static_cast<std::ptrdiff_t>(threads),finish};
+    const auto work{[&](std::size_t t){
+        while(!done)
+        {
+            auto change{0.0};
+            for(auto i{bounds[t]}; i<bounds[t+1]; ++i)
+            {
+                const auto p{m_strength[i]};
+                auto numerator{options.prior/(p+1.0)};
+                auto denominator{numerator};
+                for(auto k{m_rowStart[i]}; k<m_rowStart[i+1]; ++k)
+                {
+                    const auto q{m_strength[m_opponents[k]]};
+                    const auto share{1.0/(p+q)};
+                    numerator += m_won[k]*q*share;
+                    denominator += m_lost[k]*share;
+                }
+                next[i] = numerator > 0 && denominator > 0 ? numerator/denominator : p;
+                change = std::max(change,std::abs(next[i]-p)/p);
+            }
+            changes[t] = change;
+            sync.arrive_and_wait();
+        }
+    }};
+    std::vector<std::thread> workers;
+    for(std::size_t t=1; t<threads; ++t)
+        workers.emplace_back(work,t);
+    work(0);
+    for(auto& worker : workers)
+        worker.join();
+    return result;
+}
+
+double BradleyTerry::rating(MovieId id) const
+{
+    return 1000.0+400.0*std::log10(m_strength[id]);
+}
@@ -0,0 +1,93 @@
+#include "CatalogLoader.h"
+#include "Allocations.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+CatalogLoader::CatalogLoader(const std::string& fileName) :
+    m_snapshot{std::make_shared<const Snapshot>()}
+{
+    std::error_code error;
+    m_fileSize = std::filesystem::file_size(fileName,error);
+    if(error)
+        m_fileSize = 0;
+    m_thread = std::thread{[this,fileName]{ run(fileName); }};
+}
+
+CatalogLoader::~CatalogLoader()
+{
+    m_stop.store(true,std::memory_order_relaxed);
+    wait();
+}
+
+double CatalogLoader::progress() const
+{
+    const auto current{snapshot()};
+    if(current->done || m_fileSize == 0)
+        return 1.0;
+    return std::min(1.0,static_cast<double>(current->bytesRead)/m_fileSize);
+}
+
+double CatalogLoader::rowsPerSecond()
+{
+    m_progress.update();
+    if(m_progress.size() < 2)
+        return 0.0;
+    const auto first{m_progress.get(0)};
+    const auto last{m_progress.get(m_progress.size()-1)};
+    const std::chrono::duration<double> elapsed{last.time-first.time};
+    return elapsed.count() > 0 ? (last.rows-first.rows)/elapsed.count() : 0.0;
+}
+
+void CatalogLoader::wait()
+{
+    if(m_thread.joinable())
+        m_thread.join();
+}
+
+void CatalogLoader::run(const std::string& fileName)
+{
+    PROFILE_ZONE("catalog.load");
+    ALLOCATION_SCOPE("catalog.load");
+    auto file{std::fstream{fileName,std::ios_base::in}};
+    auto chunk{std::make_shared<Chunk>()};
+    chunk->reserve(ChunkSize);
+    std::string line;
+    while(!m_stop.load(std::memory_order_relaxed) && std::getline(file,line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(line.empty())
+            continue;
+        auto movie{Records::decodeText<Records::Movie>(line)};
+        if(!Utils::validYear(movie.year))
+            continue;
+        chunk->push_back(std::move(movie));
+        if(chunk->size() < ChunkSize)
+            continue;
+        const auto position{file.tellg()};
+        publish(std::move(chunk),position < 0 ? 0 : static_cast<std::uintmax_t>(position),false);
+        chunk = std::make_shared<Chunk>();
+        chunk->reserve(ChunkSize);
+    }
+    file.close();
+    publish(std::move(chunk),m_fileSize,true);
+}
+
+void CatalogLoader::publish(std::shared_ptr<const Chunk> chunk, std::uintmax_t bytesRead, bool done)
+{
+    // Only this thread stores, so the current snapshot cannot change underneath the copy.
+    auto next{std::make_shared<Snapshot>(*m_snapshot.load(std::memory_order_relaxed))};
+    if(!chunk->empty())
+    {
+        next->rows += chunk->size();
+        next->chunks.push_back(std::move(chunk));
+    }
+    next->bytesRead = bytesRead;
+    next->done = done;
+    const auto rows{next->rows};
+    m_snapshot.store(std::move(next),std::memory_order_release);
+    // Dropped when the UI thread is a whole window behind; the rate is then measured over a longer span.
+    m_progress.add({rows,std::chrono::steady_clock::now()});
+}
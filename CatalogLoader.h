@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Records.h"
+#include "Utils.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Reads the catalog file on a background thread. Rows are published in
+fixed-size chunks through an atomically swapped, immutable snapshot, so
+the UI thread can pick up whatever has been loaded so far without
+locking and without waiting for the whole file. Each chunk is also
+reported through a lock-free queue, from which the UI thread works out
+the loading rate.
+*/
+class CatalogLoader
+{
+public:
+    static constexpr std::size_t ChunkSize{4096};
+    // Chunks the loading rate is measured over.
+    static constexpr std::size_t RateWindow{16};
+    using Chunk = std::vector<Records::Movie>;
+
+    struct Progress
+    {
+        std::size_t rows{0};
+        std::chrono::steady_clock::time_point time{};
+    };
+
+    struct Snapshot
+    {
+        std::vector<std::shared_ptr<const Chunk>> chunks;
+        std::size_t rows{0};
+        std::uintmax_t bytesRead{0};
+        bool done{false};
+    };
+
+    explicit CatalogLoader(const std::string& fileName);
+    // Stops reading at the next line and joins the thread.
+    ~CatalogLoader();
+    CatalogLoader(const CatalogLoader&) = delete;
+    CatalogLoader& operator=(const CatalogLoader&) = delete;
+
+    std::shared_ptr<const Snapshot> snapshot() const { return m_snapshot.load(std::memory_order_acquire); }
+    std::uintmax_t fileSize() const { return m_fileSize; }
+    // Fraction of the file read so far, from 0 to 1.
+    double progress() const;
+    // Rows read per second over the last RateWindow chunks, or 0 before there are two; UI thread only.
+    double rowsPerSecond();
+    // Blocks until the whole file has been published.
+    void wait();
+private:
+    void run(const std::string& fileName);
+    void publish(std::shared_ptr<const Chunk> chunk, std::uintmax_t bytesRead, bool done);
+
+    std::uintmax_t m_fileSize{0};
+    std::atomic<std::shared_ptr<const Snapshot>> m_snapshot;
+    Utils::ConcurrentQueue<Progress> m_progress{RateWindow};
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread;
+};
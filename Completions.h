@@ -0,0 +1,203 @@
+#pragma once
+
+#include "Ranking.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <string_view>
+#include <vector>
+
+/*
+Type-ahead over movie titles. Ids are kept sorted by title, ignoring
+ASCII case, so every prefix names one contiguous range; a max-rating
+segment tree over that order yields the best-rated titles in a range
+by expanding only the nodes that can still hold one of the k best. A
+rating change updates one leaf path; a new title is inserted in place
+and the tree refilled in one linear pass.
+*/
+class Completions
+{
+    static constexpr auto Empty{-std::numeric_limits<double>::infinity()};
+
+    struct Entry
+    {
+        std::uint64_t key;
+        MovieId id;
+    };
+
+    std::vector<Entry> m_sorted;
+    std::vector<std::uint32_t> m_position;
+    std::vector<double> m_tree;
+    std::size_t m_leaves{0};
+    std::vector<MovieId> m_result;
+
+    // Bytes compare unsigned everywhere, so UTF-8 titles sort after ASCII in every comparison, as in prefixKey.
+    static unsigned char lower(char c)
+    {
+        const auto byte{static_cast<unsigned char>(c)};
+        return (byte >= 'A' && byte <= 'Z') ? byte+('a'-'A') : byte;
+    }
+
+    // Case-insensitive ordering of a against b; a prefix of b sorts first.
+    static bool less(std::string_view a, std::string_view b)
+    {
+        const auto n{std::min(a.size(),b.size())};
+        for(std::size_t i=0; i<n; ++i)
+            if(lower(a[i]) != lower(b[i]))
+                return lower(a[i]) < lower(b[i]);
+        return a.size() < b.size();
+    }
+
+    static bool startsWith(std::string_view text, std::string_view prefix)
+    {
+        if(text.size() < prefix.size())
+            return false;
+        for(std::size_t i=0; i<prefix.size(); ++i)
+            if(lower(text[i]) != lower(prefix[i]))
+                return false;
+        return true;
+    }
+
+    // First eight bytes, lowercased, packed so that integer order matches title order whenever they differ.
+    static std::uint64_t prefixKey(std::string_view title)
+    {
+        std::uint64_t key{0};
+        for(std::size_t i=0; i<8; ++i)
+            key = key << 8 | (i < title.size() ? lower(title[i]) : 0);
+        return key;
+    }
+
+    // Title order, then id; the strings are only read when the packed prefixes tie.
+    template<class Title>
+    static auto ordering(const Title& title)
+    {
+        return [&title](const Entry& a, const Entry& b)
+        {
+            if(a.key != b.key)
+                return a.key < b.key;
+            const std::string_view ta{title(a.id)};
+            const std::string_view tb{title(b.id)};
+            const auto n{std::min(ta.size(),tb.size())};
+            for(std::size_t i=8; i<n; ++i)
+                if(lower(ta[i]) != lower(tb[i]))
+                    return lower(ta[i]) < lower(tb[i]);
+            return ta.size() != tb.size() ? ta.size() < tb.size() : a.id < b.id;
+        };
+    }
+
+    template<class Title>
+    void append(MovieId first, MovieId last, const Title& title)
+    {
+        for(auto id{first}; id<last; ++id)
+            m_sorted.push_back({prefixKey(title(id)),id});
+    }
+
+    void renumber(std::size_t first)
+    {
+        for(auto i{first}; i<m_sorted.size(); ++i)
+            m_position[m_sorted[i].id] = static_cast<std::uint32_t>(i);
+    }
+
+    void set(std::size_t position, double rating)
+    {
+        auto node{m_leaves+position};
+        m_tree[node] = rating;
+        for(node/=2; node>0; node/=2)
+            m_tree[node] = std::max(m_tree[2*node],m_tree[2*node+1]);
+    }
+
+public:
+    // title(id) returns the name as something convertible to string_view, rating(id) its rating.
+    template<class Title, class Rating>
+    void rebuild(std::size_t count, const Title& title, const Rating& rating)
+    {
+        m_sorted.clear();
+        m_sorted.reserve(count);
+        append(0,static_cast<MovieId>(count),title);
+        std::sort(m_sorted.begin(),m_sorted.end(),ordering(title));
+        m_position.resize(count);
+        renumber(0);
+        refresh(rating);
+    }
+
+    // Re-reads every rating, keeping the title order.
+    template<class Rating>
+    void refresh(const Rating& rating)
+    {
+        m_leaves = std::bit_ceil(std::max<std::size_t>(m_sorted.size(),1));
+        m_tree.assign(2*m_leaves,Empty);
+        for(std::size_t i=0; i<m_sorted.size(); ++i)
+            m_tree[m_leaves+i] = rating(m_sorted[i].id);
+        for(auto node{m_leaves-1}; node>0; --node)
+            m_tree[node] = std::max(m_tree[2*node],m_tree[2*node+1]);
+    }
+
+    template<class Title, class Rating>
+    void insert(MovieId id, const Title& title, const Rating& rating)
+    {
+        insert(id,id+1,title,rating);
+    }
+
+    // Adds the new ids [first,last) in one pass: they are sorted among themselves and merged in.
+    template<class Title, class Rating>
+    void insert(MovieId first, MovieId last, const Title& title, const Rating& rating)
+    {
+        const auto middle{static_cast<std::ptrdiff_t>(m_sorted.size())};
+        append(first,last,title);
+        const auto order{ordering(title)};
+        std::sort(m_sorted.begin()+middle,m_sorted.end(),order);
+        std::inplace_merge(m_sorted.begin(),m_sorted.begin()+middle,m_sorted.end(),order);
+        m_position.resize(std::max<std::size_t>(m_position.size(),last));
+        renumber(0);
+        refresh(rating);
+    }
+
+    void update(MovieId id, double rating)
+    {
+        set(m_position[id],rating);
+    }
+
+    // Up to k ids whose title starts with prefix, best rated first. Valid until the next call.
+    template<class Title, class Rating>
+    const std::vector<MovieId>& top(std::string_view prefix, std::size_t k, const Title& title, const Rating& rating)
+    {
+        m_result.clear();
+        if(k == 0 || m_sorted.empty())
+            return m_result;
+        const auto first{std::partition_point(m_sorted.begin(),m_sorted.end(),[&](const Entry& entry){ return less(title(entry.id),prefix); })};
+        const auto last{std::partition_point(first,m_sorted.end(),[&](const Entry& entry){ return startsWith(title(entry.id),prefix); })};
+
+        // Canonical nodes covering [first,last), then best-first expansion.
+        const auto byMax{[this](std::size_t a, std::size_t b){ return m_tree[a] < m_tree[b]; }};
+        std::priority_queue<std::size_t,std::vector<std::size_t>,decltype(byMax)> frontier{byMax};
+        for(auto l{m_leaves+(first-m_sorted.begin())}, r{m_leaves+(last-m_sorted.begin())}; l<r; l/=2, r/=2)
+        {
+            if(l & 1)
+                frontier.push(l++);
+            if(r & 1)
+                frontier.push(--r);
+        }
+        while(!frontier.empty() && m_result.size() < k)
+        {
+            const auto node{frontier.top()};
+            frontier.pop();
+            if(m_tree[node] == Empty)
+                break;
+            if(node >= m_leaves)
+            {
+                m_result.push_back(m_sorted[node-m_leaves].id);
+                continue;
+            }
+            frontier.push(2*node);
+            frontier.push(2*node+1);
+        }
+        // Equal ratings come out in tree order; order them the way Ranking does.
+        std::stable_sort(m_result.begin(),m_result.end(),[&rating](MovieId a, MovieId b){ return rating(a) > rating(b) || (rating(a) == rating(b) && a < b); });
+        return m_result;
+    }
+
+    std::size_t size() const { return m_sorted.size(); }
+};
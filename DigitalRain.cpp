@@ -1,21 +1,23 @@
 #include "DigitalRain.h"
 #include "Raindrop.h"
+#include "Screen.h"
+#include "Session.h"
 #include "Utils.h"
 #include "ncurses.h"
 
-DigitalRain::DigitalRain()
+DigitalRain::DigitalRain(Screen& screen)
 {
-    for(int column=0; column<COLS; column++)
+    for(int column=0; column<screen.columns(); column++)
         rain.push_back(new Raindrop(column,rand()%2));
 
-    while(getch()!='q'){
+    while(Session::key()!='q'){
         for(const auto& raindrop : rain)
         {   
             if(rand()%800 < 10)
                 raindrop->blankSpace(Utils::rng(LINES/2,LINES-LINES/8)); 
-            raindrop->update();
+            raindrop->update(screen);
         }
-        refresh();
+        screen.present();
     }
 }
 
@@ -2,10 +2,11 @@
 #include <vector> 
 
 class Raindrop;
+class Screen;
 
 class DigitalRain{
 public:
-    DigitalRain();
+    explicit DigitalRain(Screen& screen);
     ~DigitalRain();
 private:
     std::vector<Raindrop*> rain;
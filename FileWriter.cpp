@@ -0,0 +1,57 @@
+#include "FileWriter.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+FileWriter::FileWriter(std::string fileName) :
+    m_fileName{std::move(fileName)},
+    m_tempName{m_fileName+".tmp"}
+{
+    m_fd = ::open(m_tempName.c_str(),O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0644);
+    m_buffer.reserve(BufferSize+BufferSize/4);
+}
+
+FileWriter::~FileWriter()
+{
+    if(m_fd >= 0)
+    {
+        ::close(m_fd);
+        ::unlink(m_tempName.c_str());
+    }
+}
+
+void FileWriter::flush()
+{
+    auto data{m_buffer.data()};
+    auto left{m_buffer.size()};
+    while(left > 0 && !m_failed && m_fd >= 0)
+    {
+        const auto written{::write(m_fd,data,left)};
+        ++m_writes;
+        if(written < 0)
+        {
+            m_failed = errno != EINTR;
+            continue;
+        }
+        data += written;
+        left -= written;
+    }
+    m_buffer.clear();
+}
+
+bool FileWriter::commit()
+{
+    if(m_fd < 0)
+        return false;
+    flush();
+    const auto synced{::fsync(m_fd) == 0};
+    const auto closed{::close(m_fd) == 0};
+    m_fd = -1;
+    if(m_failed || !synced || !closed || std::rename(m_tempName.c_str(),m_fileName.c_str()) != 0)
+    {
+        ::unlink(m_tempName.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+Writes a file through one large reusable buffer into a temporary next
+to the target, then renames it over the target. Readers see either the
+old file or the complete new one, and a full buffer costs one write
+call. A writer that is destroyed without commit() removes its temporary.
+*/
+class FileWriter
+{
+public:
+    static constexpr std::size_t BufferSize{1 << 20};
+
+    explicit FileWriter(std::string fileName);
+    ~FileWriter();
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    bool good() const { return m_fd >= 0; }
+    // Records are formatted straight into the buffer; call flushIfFull() after each one.
+    std::string& buffer() { return m_buffer; }
+    void append(std::string_view text) { m_buffer += text; flushIfFull(); }
+    void flushIfFull() { if(m_buffer.size() >= BufferSize) flush(); }
+    // Flushes, syncs and renames the temporary into place; false if any step failed.
+    bool commit();
+    std::size_t writes() const { return m_writes; }
+private:
+    void flush();
+
+    std::string m_fileName;
+    std::string m_tempName;
+    std::string m_buffer;
+    std::size_t m_writes{0};
+    int m_fd{-1};
+    bool m_failed{false};
+};
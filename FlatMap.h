@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/*
+Open-addressing hash map for integral keys. Slots live in one contiguous
+array and collisions are resolved by linear probing, so lookups and
+iteration stay within a few cache lines instead of chasing list nodes.
+The largest key value is reserved as the empty marker.
+*/
+template<class K, class V>
+class FlatMap
+{
+public:
+    struct Slot
+    {
+        K key{Empty};
+        V value{};
+    };
+
+    class Iterator
+    {
+        const Slot* m_slot;
+        const Slot* m_end;
+        void skip() { while(m_slot != m_end && m_slot->key == Empty) ++m_slot; }
+    public:
+        Iterator(const Slot* slot, const Slot* end) : m_slot{slot}, m_end{end} { skip(); }
+        const Slot& operator*() const { return *m_slot; }
+        const Slot* operator->() const { return m_slot; }
+        Iterator& operator++() { ++m_slot; skip(); return *this; }
+        bool operator!=(const Iterator& other) const { return m_slot != other.m_slot; }
+    };
+
+    static constexpr K Empty{std::numeric_limits<K>::max()};
+
+    V& operator[](K key)
+    {
+        if((m_size+1)*4 > m_slots.size()*3)
+            grow();
+        auto& slot{probe(key)};
+        if(slot.key == Empty)
+        {
+            slot.key = key;
+            ++m_size;
+        }
+        return slot.value;
+    }
+
+    const V* find(K key) const
+    {
+        if(m_slots.empty())
+            return nullptr;
+        const auto& slot{const_cast<FlatMap*>(this)->probe(key)};
+        return slot.key == Empty ? nullptr : &slot.value;
+    }
+
+    void reserve(std::size_t count)
+    {
+        while(count*4 > m_slots.size()*3)
+            grow();
+    }
+
+    void clear()
+    {
+        m_slots.clear();
+        m_size = 0;
+    }
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    Iterator begin() const { return {m_slots.data(),m_slots.data()+m_slots.size()}; }
+    Iterator end() const { return {m_slots.data()+m_slots.size(),m_slots.data()+m_slots.size()}; }
+
+private:
+    std::vector<Slot> m_slots;
+    std::size_t m_size{0};
+
+    static std::size_t hash(K key)
+    {
+        // Fibonacci hashing spreads sequential ids across the table
+        return static_cast<std::size_t>(static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ull >> 32);
+    }
+
+    Slot& probe(K key)
+    {
+        const auto mask{m_slots.size()-1};
+        auto index{hash(key) & mask};
+        while(m_slots[index].key != key && m_slots[index].key != Empty)
+            index = (index+1) & mask;
+        return m_slots[index];
+    }
+
+    void grow()
+    {
+        auto old{std::move(m_slots)};
+        m_slots = std::vector<Slot>(old.empty() ? 16 : old.size()*2);
+        for(const auto& slot : old)
+            if(slot.key != Empty)
+                probe(slot.key) = slot;
+    }
+};
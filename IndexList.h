@@ -0,0 +1,127 @@
+#pragma once
+
+#include "List.h"
+#include <cstdint>
+#include <vector>
+
+/*
+Linked list stored as parallel arrays: values in one vector and 32-bit
+next indices in another. Links stay half the size of pointers and all
+nodes share two contiguous allocations; freed slots are chained through
+the index array and reused. Same interface as List<T>.
+*/
+template<class T>
+class IndexList
+{
+    static constexpr std::uint32_t Null{UINT32_MAX};
+    static constexpr std::size_t SlotSize{sizeof(T)+sizeof(std::uint32_t)};
+
+    std::size_t m_allocated{0};
+    std::size_t m_freed{0};
+    std::size_t m_size{0};
+
+    std::vector<T> m_values;
+    std::vector<std::uint32_t> m_next;
+    std::uint32_t m_head{Null};
+    std::uint32_t m_tail{Null};
+    std::uint32_t m_free{Null};
+public:
+    IndexList(const T& rootValue)
+    {
+        append(rootValue);
+    }
+
+    void append(const T& value)
+    {
+        std::uint32_t slot{m_free};
+        if(slot != Null)
+        {
+            m_free = m_next[slot];
+            m_values[slot] = value;
+        }
+        else
+        {
+            slot = static_cast<std::uint32_t>(m_values.size());
+            m_values.push_back(value);
+            m_next.push_back(Null);
+        }
+        m_next[slot] = Null;
+        m_allocated+=SlotSize;
+        ++m_size;
+        if(m_tail != Null)
+            m_next[m_tail] = slot;
+        else
+            m_head = slot;
+        m_tail = slot;
+    }
+
+    bool remove(int n)
+    {
+        if(n<0 || n>=m_size)
+            return false;
+        auto slot{m_head};
+        std::uint32_t prev{Null};
+        for(int count=0; count<n; ++count)
+        {
+            prev = slot;
+            slot = m_next[slot];
+        }
+
+        if(prev != Null)
+            m_next[prev] = m_next[slot];
+        else
+            m_head = m_next[slot];
+
+        if(slot == m_tail)
+            m_tail = prev;
+
+        release(slot);
+        return true;
+    }
+
+    void clear()
+    {
+        m_freed+=m_size*SlotSize;
+        m_size = 0;
+        m_values.clear();
+        m_next.clear();
+        m_head = m_tail = m_free = Null;
+    }
+
+    std::size_t size() const { return m_size; }
+
+    template<class F>
+    void forEach(F&& fcn) const
+    {
+        for(auto slot{m_head}; slot != Null; slot = m_next[slot])
+            fcn(m_values[slot]);
+    }
+
+    void print(std::ostream& os) const
+    {
+        constexpr auto Bar{"+------------------------------+"};
+        const auto reserved{m_values.capacity()*sizeof(T)+m_next.capacity()*sizeof(std::uint32_t)};
+        os << Bar <<std::endl;
+        os <<memoryUsage(m_allocated,m_freed,reserved)<< "INDEXED\tSize: "<<m_size<<", Type: "<<Utils::typeName(T{})<<std::endl;
+        int count{0};
+        for(auto slot{m_head}; slot != Null; slot = m_next[slot])
+        {
+            const std::string ind(count,' ');
+            if(slot != m_head)
+                os << "\n" <<ind<<"|\n"<<ind << "+->";
+            os << (slot==m_head ? "Head" : m_next[slot]==Null ? "Tail" : "Node"+std::to_string(count))
+               << "[#" << slot << " val = " << m_values[slot] << "]";
+            ++count;
+        }
+        os << std::endl;
+        os << Bar <<std::endl;
+    }
+private:
+    void release(std::uint32_t slot)
+    {
+        m_freed+=SlotSize;
+        --m_size;
+        m_next[slot] = m_free;
+        m_free = slot;
+    }
+};
@@ -0,0 +1,33 @@
+#include "Life.h"
+#include "Utils.h"
+
+Life::Life(int height, int width) :
+    m_height{height},
+    m_width{width},
+    m_cells(height*width),
+    m_next(height*width)
+{
+    for(int y=1; y<height-1; ++y)
+        for(int x=1; x<width-1; ++x)
+            m_cells[y*width+x] = Utils::rng(0,10) >= 6;
+}
+
+int Life::step()
+{
+    int liveCount{0};
+    for(int y=1; y<m_height-1; ++y)
+    {
+        const auto above{&m_cells[(y-1)*m_width]};
+        const auto row{&m_cells[y*m_width]};
+        const auto below{&m_cells[(y+1)*m_width]};
+        const auto next{&m_next[y*m_width]};
+        for(int x=1; x<m_width-1; ++x)
+        {
+            const auto neighbours{above[x-1]+above[x]+above[x+1]+row[x-1]+row[x+1]+below[x-1]+below[x]+below[x+1]};
+            next[x] = row[x] ? (neighbours>1 && neighbours<4) : (neighbours==3);
+            liveCount += next[x];
+        }
+    }
+    std::swap(m_cells,m_next);
+    return liveCount;
+}
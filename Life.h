@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+Conway's Game of Life on a fixed grid whose outer ring stays dead.
+Cells live in one flat byte array and each step writes the next
+generation into a second array, so the simulation never reads back
+from the screen.
+*/
+class Life
+{
+public:
+    Life(int height, int width);
+    // Advances one generation and returns the number of live cells.
+    int step();
+    bool alive(int y, int x) const { return m_cells[y*m_width+x]; }
+    int height() const { return m_height; }
+    int width() const { return m_width; }
+private:
+    int m_height;
+    int m_width;
+    std::vector<std::uint8_t> m_cells;
+    std::vector<std::uint8_t> m_next;
+};
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "Utils.h"
+#include <new>
 #include <sstream>
+#include <vector>
 
 template<class T>
 struct Node
@@ -8,9 +11,77 @@ struct Node
     T value{};
     Node<T>* next{nullptr};
     Node(const T& val) : value{val} {}
-    constexpr std::size_t sizeReq() { return sizeof(Node<T>*); }
+    static constexpr std::size_t sizeReq() { return sizeof(Node<T>); }
 };
 
+/*
+Hands out nodes of type N from fixed-size slabs. Destroyed nodes are
+threaded onto a freelist through their own storage and reused before
+another slab is requested, so steady append/remove traffic never reaches
+the heap.
+*/
+template<class N>
+class NodePool
+{
+    static constexpr std::size_t SlabNodes{64};
+
+    struct FreeNode{ FreeNode* next; };
+    static_assert(sizeof(N) >= sizeof(FreeNode), "Nodes must be able to hold a freelist link");
+
+    std::vector<N*> m_slabs;
+    FreeNode* m_free{nullptr};
+    std::size_t m_used{SlabNodes};
+public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    ~NodePool()
+    {
+        for(const auto slab : m_slabs)
+            ::operator delete(slab, std::align_val_t{alignof(N)});
+    }
+
+    template<class... Args>
+    N* create(Args&&... args)
+    {
+        void* memory{nullptr};
+        if(m_free)
+        {
+            memory = m_free;
+            m_free = m_free->next;
+        }
+        else
+        {
+            if(m_used == SlabNodes)
+            {
+                m_slabs.push_back(static_cast<N*>(::operator new(SlabNodes*sizeof(N), std::align_val_t{alignof(N)})));
+                m_used = 0;
+            }
+            memory = m_slabs.back()+m_used++;
+        }
+        return new(memory) N{std::forward<Args>(args)...};
+    }
+
+    void destroy(N* node)
+    {
+        node->~N();
+        m_free = new(node) FreeNode{m_free};
+    }
+
+    std::size_t reserved() const { return m_slabs.size()*SlabNodes*sizeof(N); }
+};
+
+inline std::string memoryUsage(std::size_t allocated, std::size_t freed, std::size_t reserved)
+{
+    std::stringstream ss;
+    ss << "MEMORY\t"
+        <<"Alloc: " << Utils::storage(allocated)
+        <<", Freed: " << Utils::storage(freed)
+        << ", Leak: " << Utils::storage(allocated-freed)
+        << ", Pool: " << Utils::storage(reserved) <<std::endl;
+    return ss.str();
+}
+
 template<class T>
 class List
 {
@@ -18,64 +89,54 @@ class List
     std::size_t m_freed{0};
     std::size_t m_size{0};
 
+    NodePool<Node<T>> m_pool;
     Node<T>* m_head{nullptr};
+    Node<T>* m_tail{nullptr};
 public:
     List(const T& rootValue)
     {
-        m_head = new Node{rootValue};
-        m_allocated += m_head->sizeReq();
-        ++m_size;
+        append(rootValue);
     }
-    ~List() 
+    ~List()
     {
         clear();
     }
+    List(const List&) = delete;
+    List& operator=(const List&) = delete;
 
-    void append(const T& value) 
+    void append(const T& value)
     {
-        auto newNode{new Node{value}};
+        auto newNode{m_pool.create(value)};
         m_allocated+=newNode->sizeReq();
         ++m_size;
-        auto temp{m_head};
-        while(temp->next) { temp = temp->next; }
-        temp->next = newNode;
+        if(m_tail)
+            m_tail->next = newNode;
+        else
+            m_head = newNode;
+        m_tail = newNode;
     }
 
-    bool remove(int n) 
+    bool remove(int n)
     {
-        if(n==0 && m_size==1)
-        {
-            m_freed+=m_head->sizeReq();
-            --m_size;
-            delete m_head;
-            m_head = nullptr;
-            return true;
-        }
-        if(n<0 || n>=m_size) 
+        if(n<0 || n>=m_size)
             return false;
         auto temp{m_head};
         Node<T>* prev{nullptr};
-        int count{0};
-        while(temp)
+        for(int count=0; count<n; ++count)
         {
-            if(n==count)
-                break;
             prev = temp;
             temp = temp->next;
-            ++count;
         }
-        if(!temp)
-            return false;
 
-        if(temp==m_head && temp->next) // update head when deleting current head
-            m_head = temp->next;
-  
-        if(prev && temp) // connect previous and next node
+        if(prev) // connect previous and next node
             prev->next = temp->next;
+        else // update head when deleting current head
+            m_head = temp->next;
 
-        m_freed+=temp->sizeReq();
-        --m_size;
-        delete temp;
+        if(temp==m_tail)
+            m_tail = prev;
+
+        release(temp);
         return true;
     }
 
@@ -85,23 +146,28 @@ public:
         while(temp)
         {
             auto toDelete = temp;
-            --m_size;
-            m_freed+=toDelete->sizeReq();
             temp = temp->next;
-            delete toDelete;
-            toDelete = nullptr;
+            release(toDelete);
         }
         m_head = nullptr;
+        m_tail = nullptr;
     }
 
-    std::size_t size() { return m_size; }
+    std::size_t size() const { return m_size; }
+
+    template<class F>
+    void forEach(F&& fcn) const
+    {
+        for(auto curr{m_head}; curr; curr = curr->next)
+            fcn(curr->value);
+    }
 
     void print(std::ostream& os) const
     {
 
         constexpr auto Bar{"+------------------------------+"};
         os << Bar <<std::endl;
-        os <<memory()<< "PRINT\tSize: "<<m_size<<", Type: "<<Utils::typeName(T{})<<std::endl;
+        os <<memoryUsage(m_allocated,m_freed,m_pool.reserved())<< "PRINT\tSize: "<<m_size<<", Type: "<<Utils::typeName(T{})<<std::endl;
         auto curr{m_head};
         int count{0};
         while(curr)
@@ -117,29 +183,26 @@ public:
         os << Bar <<std::endl;
     }
 private:
-    std::string memory() const
+    void release(Node<T>* node)
     {
-        std::stringstream ss;
-        ss << "MEMORY\t"
-            <<"Alloc: " << Utils::storage(m_allocated) 
-            <<", Freed: " << Utils::storage(m_freed) 
-            << ", Leak: " << Utils::storage(m_allocated-m_freed) <<std::endl;
-        return ss.str();
+        m_freed+=node->sizeReq();
+        --m_size;
+        m_pool.destroy(node);
     }
-    
+
     std::string str(Node<T>* node, int n) const
     {
         std::stringstream ss;
         if(!node)
             ss << "Null";
-        else if(node==m_head) 
+        else if(node==m_head)
             ss << "Head";
-        else if(!node->next) 
+        else if(!node->next)
             ss << "Tail";
-        else 
+        else
             ss << "Node"<< n;
-        
+
         ss << "[val = " << node->value << "]";
         return ss.str();
     }
-};
\ No newline at end of file
+};
@@ -1,9 +1,30 @@
 #include "Movies.h"
+#include "Allocations.h"
+#include "BradleyTerry.h"
 #include "DigitalRain.h"
+#include "FileWriter.h"
 #include "List.h"
+#include "UnrolledList.h"
+#include "IndexList.h"
+#include "Life.h"
+#include "Plot.h"
+#include "Profiler.h"
+#include "Screen.h"
+#include "Session.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <clocale>
+#include <cmath>
+#include <filesystem>
 #include <fstream>
+#include <optional>
+#include <sstream>
 #include <iostream>
 #include <thread>
+#include <variant>
 
 using namespace std::chrono_literals;
 
@@ -17,6 +38,11 @@ namespace
 {
     constexpr auto Filename{"movies.txt"};
     constexpr auto HighscoreFilename{"score.txt"};
+    constexpr auto ComparisonsFilename{"comparisons.txt"};
+    constexpr auto HistoryFilename{"history.bin"};
+    constexpr auto TraceFilename{"trace.json"};
+    // Set to "direct" to start with the animated views drawing without ncurses.
+    constexpr auto RendererVariable{"RATEMOVIES_RENDERER"};
 
     constexpr auto CYAN{1};
     constexpr auto YELLOW{2};
@@ -29,7 +55,7 @@ namespace
     void setText(WINDOW* w, int y, int x, const char* text) { mvwprintw(w,y,x,text); }
 
     enum class Direction{ Up, Left, Down, Right};
-    constexpr auto updateDirection(char c, Direction dir)
+    constexpr auto updateDirection(int c, Direction dir)
     {
         switch(c)
         {
@@ -41,7 +67,61 @@ namespace
         }
     }
 
-    struct Diff{ double diff; int number; WINDOW* w; };
+    struct Diff{ double diff; MovieId number; WINDOW* w; };
+
+    // Accepts "a", "a-b" or "a+" (a and above); an empty field leaves both bounds unchanged.
+    template<class T>
+    bool parseRange(std::string_view text, T& low, T& high)
+    {
+        if(text.empty())
+            return true;
+        const auto end{text.data()+text.size()};
+        T first{};
+        const auto [ptr,ec]{std::from_chars(text.data(),end,first)};
+        if(ec != std::errc{})
+            return false;
+        if(ptr == end)
+        {
+            low = high = first;
+            return true;
+        }
+        if(*ptr == '+' && ptr+1 == end)
+        {
+            low = first;
+            return true;
+        }
+        T second{};
+        const auto [last,ec2]{std::from_chars(ptr+1,end,second)};
+        if(*ptr != '-' || ec2 != std::errc{} || last != end)
+            return false;
+        low = first;
+        high = second;
+        return true;
+    }
+
+    // Plots series on rows [top, bottom] of the screen, with the y range left of it and the x range below.
+    void drawSeries(Screen& screen, Plot::Canvas& canvas, Plot::Plotter& plotter, const Plot::Series& series, Plot::Method method, int top, int bottom)
+    {
+        constexpr auto Axis{10};
+        const auto width{screen.columns()};
+        canvas.resize(width-2-Axis,bottom-top+1);
+        canvas.clear();
+        if(series.empty() || canvas.columns() < 1 || canvas.rows() < 1)
+            return;
+        auto [low,high]{series.extent(0,series.size())};
+        plotter.draw(series,method,canvas,series.front().x,series.back().x,low,high);
+        for(int row=0; row<canvas.rows(); ++row)
+            screen.text(top+row,Axis+1,canvas.row(row,Screen::unicode()));
+        char label[32];
+        std::snprintf(label,sizeof(label),"%*.6g",Axis-1,high);
+        screen.text(top,1,label);
+        std::snprintf(label,sizeof(label),"%*.6g",Axis-1,low);
+        screen.text(bottom,1,label);
+        std::snprintf(label,sizeof(label),"%.6g",series.front().x);
+        screen.text(bottom+1,Axis+1,label);
+        std::snprintf(label,sizeof(label),"%.6g",series.back().x);
+        screen.text(bottom+1,std::max(Axis+1,width-1-static_cast<int>(std::strlen(label))),label);
+    }
 
     auto cleanup(WINDOW* win, int h_win, int w_win)
     {
@@ -52,22 +132,44 @@ namespace
 }
 
 Movies::Movies() :
+    Movies(std::unique_ptr<ShardedCatalog>{},std::unique_ptr<RatingClient>{})
+{
+}
+
+Movies::Movies(const std::filesystem::path& archive, std::size_t budgetBytes) :
+    Movies(std::make_unique<ShardedCatalog>(archive,budgetBytes),std::unique_ptr<RatingClient>{})
+{
+}
+
+Movies::Movies(std::unique_ptr<RatingClient> client) :
+    Movies(std::unique_ptr<ShardedCatalog>{},std::move(client))
+{
+}
+
+Movies::Movies(std::unique_ptr<ShardedCatalog> archive, std::unique_ptr<RatingClient> client) :
+    m_archive{std::move(archive)},
+    m_client{std::move(client)},
     m_menuItems{
     {
         {"Add movie.",      [this]{ addMovie(); return 1; }},
-        {"Rate two movies", [this]{ for(int i=0; i<10; i++) rateMovies(); return 1; }},
+        {"Rate two movies", [this]{ if(m_client || !readOnly()) for(int i=0; i<10; i++) rateMovies(); return 1; }},
         {"Search for movie",[this]{ search(); return 1; }},
         {"Browse",          [this]{ browse(); return 1; }},
         {"Recommend",       [this]{ recommend(); return 1; }},
-        {"Reset ratings",   [this]{ reset(); return 1; }}},
+        {"Reset ratings",   [this]{ reset(); return 1; }},
+        {"Profiles",        [this]{ profiles(); return 1; }}},
     {
         {"Snake",           [this]{ snake(); return 1; }},
         {"Game of Life",    [this]{ gameOfLife(); return 1; }},
         {"Graph",           [this]{ graph(); return 1; }},
         {"Matrix",          [this]{ 
+            const Session::View view{"matrix"};
             timeout(20);
             attron(COLOR_PAIR(GREEN));
-            DigitalRain(); 
+            {
+                Screen screen{stdscr,m_renderer};
+                DigitalRain{screen};
+            }
             timeout(-1);
             attron(COLOR_PAIR(CYAN));
             cleanup(stdscr,LINES,COLS);
@@ -77,13 +179,26 @@ Movies::Movies() :
         {"List",            [this]{ list(); return 1; }}
     },
     {
+        {"Profiler",        [this]{ profiler(); return 1; }},
+        {"Memory",          [this]{ memory(); return 1; }},
         {"Exit",            []{ return 0; }}
     }},
     m_titles{"Movies","Games","Misc."}
 {  
-    loadMovies();
+    if(!m_archive && !m_client)
+    {
+        m_loader = std::make_unique<CatalogLoader>(Filename);
+        loadComparisons();
+        m_history.load(HistoryFilename);
+        // A recorded session starts from the whole catalog, so its replay finds the same rows behind every key.
+        if(Session::mode() != Session::Mode::Live)
+            finishLoading();
+    }
     loadHighscores();
-    initscr();
+    if(const auto renderer{std::getenv(RendererVariable)}; renderer && std::string_view{renderer} == Screen::name(Screen::Renderer::Direct))
+        m_renderer = Screen::Renderer::Direct;
+    std::setlocale(LC_CTYPE,"");
+    Session::initScreen();
     curs_set(0);
     initColors();
     noecho();
@@ -93,10 +208,30 @@ Movies::Movies() :
 
 Movies::~Movies()
 {
-    std::filesystem::remove(Filename);
-    std::filesystem::remove(HighscoreFilename);
-    serializeToFile(Filename, m_movies);
-    serializeToFile(HighscoreFilename, m_scores);
+    finishLoading();
+    // Recording and replaying leave the files as they were, so every replay starts from the state that was recorded.
+    const auto live{Session::mode() == Session::Mode::Live};
+    if(!m_archive && !m_client && live)
+    {
+        m_profiles.store(m_profiles.active(),m_ratings);
+        const auto& ratings{m_profiles.load(Profiles::Default,m_movies.size())};
+        FileWriter writer{Filename};
+        Movie record;
+        for(MovieId id=0; id<m_movies.size(); ++id)
+        {
+            record.rating = ratings[id];
+            record.name = name(id);
+            record.year = m_movies[id].year;
+            Records::encodeText(record,writer.buffer());
+            writer.flushIfFull();
+        }
+        writer.commit();
+        m_profiles.save();
+        Records::serializeToFile(ComparisonsFilename, m_comparisons);
+        m_history.save(HistoryFilename);
+    }
+    if(live)
+        Records::serializeToFile(HighscoreFilename, m_scores);
     shutdown();
 }
 
@@ -141,7 +276,7 @@ void Movies::initColors()
 
 int Movies::execute() 
 {
-    char c{'\0'};
+    int c{'\0'};
     int menuIndex{ 0 };
     int pos{ 0 };
     auto offset{0}; 
@@ -177,6 +312,10 @@ int Movies::execute()
                     return m_exitCode; 
                 break; 
             }
+            case 'v':
+            case 'V':
+                m_renderer = m_renderer == Screen::Renderer::Curses ? Screen::Renderer::Direct : Screen::Renderer::Curses;
+                break;
         }
         for(int i=1; i<=menuIndex; ++i)
             offset+=m_menuItems[i-1].size();
@@ -185,70 +324,73 @@ int Movies::execute()
         setText(stdscr,pos+2+offset,2,"*");
         mvchgat(pos+2+offset,2,1,A_STANDOUT,COLOR_PAIR(1),nullptr);
         box(stdscr,0,0);
+        // Above the help items of createMenu, with the renderer in use.
+        char renderer[32];
+        std::snprintf(renderer,sizeof(renderer),"V       - %-7s",Screen::name(m_renderer));
+        setText(stdscr,LINES-7,4,renderer);
+        drawLoadingStatus();
         refresh();
-        c = getch();
+        if(!m_interactive)
+        {
+            static const auto interactiveZone{Profiler::zone("startup.interactive")};
+            Profiler::record(interactiveZone,m_started,Profiler::now());
+            m_interactive = true;
+        }
+        c = waitKey();
+        adoptLoaded();
     }
     return m_exitCode;
 }
 
 void Movies::recommend()
 {
-    const auto randomMovie{ m_movies[Utils::rng(0,m_movies.size()-1)] };
-    auto w{ newwin(5,globalWidth+10,2,21) };
+    ALLOCATION_SCOPE("recommend");
+    const Session::View view{"recommend"};
+    if(m_archive)
+        return archiveRecommend();
+    if(m_client)
+    {
+        readOnly();
+        return;
+    }
+    constexpr auto Count{10};
+    const auto& candidates{m_recommender.top(Count,m_ratings,m_ratedMovies,m_ratedGeneration,[this](MovieId id){ return m_movies[id].year; },Utils::currentYear())};
+    auto w{ newwin(Count+2,globalWidth+10,2,21) };
     wattron(w,COLOR_PAIR(MAGENTA));
-    setText(w,1,2, displayString(randomMovie, "RANDOM:  ").c_str());
-    if(!m_ratedMovies.empty())
+    int y{1};
+    for(const auto& candidate : candidates)
     {
-        const auto [highestDiff,diff]{highestDiffMovie()};
-        const auto str{displayString(highestDiff, "HOTTEST: ") +" +"+std::to_string(static_cast<int>(diff))+""};
-        setText(w,2,2, str.c_str());
-        mvwchgat(w,2,str.size()-1,4,A_BOLD,COLOR_MAGENTA,nullptr);
+        const auto str{displayString(movie(candidate.id), (y < 10 ? " " : "")+std::to_string(y)+". ")};
+        setText(w,y,2,str.c_str());
+        if(const auto diff{m_ratedMovies.find(candidate.id)}; diff && *diff >= 1)
+        {
+            const auto hot{" +"+std::to_string(static_cast<int>(*diff))};
+            setText(w,y,2+str.size(),hot.c_str());
+            mvwchgat(w,y,2+str.size(),hot.size(),A_BOLD,COLOR_MAGENTA,nullptr);
+        }
+        setText(w,y,globalWidth-6,("score "+std::to_string(candidate.score).substr(0,5)).c_str());
+        ++y;
     }
-    setText(w,3,2, displayString(highestRatedMovie(), "HIGHEST: ").c_str());
     box(w,0,0);
     setText(w,0,2,"RECOMMENDATION");
-    setText(w,3,1," ");
     wrefresh(w);
-    getch();
+    Session::key();
     delwin(w);
 }
 
-std::pair<Movies::Movie,double> Movies::highestDiffMovie()
-{
-    Movie highestDiff;
-    double diff{0};
-    for(const auto[index, difference] : m_ratedMovies)
-        if(difference > diff)
-        {    
-            highestDiff = m_movies[index];
-            diff = difference;
-        }
-    return{ highestDiff,diff };
-}
-
-Movies::Movie Movies::highestRatedMovie()
-{
-    Movie highestRated;
-    double rating{0};
-    for(const auto& movie : m_movies)
-        if(movie.rating > rating)
-        {    
-            highestRated = movie;
-            rating = movie.rating;
-        }
-    return highestRated;    
-}  
-
 void Movies::snake()
 {
+    ALLOCATION_SCOPE("snake");
+    const Session::View view{"snake"};
     constexpr auto xStart{21};
     const auto width{COLS-xStart-3};
     const auto height{LINES-2};
     auto w{ newwin(height,width,1,xStart+2) };
+    Screen screen{w,m_renderer};
     Utils::Position pos{height/2, width/2};
-    box(w,0,0);
-    Direction dir;
-    char c{'\0'};
+    screen.outline();
+    Direction dir{Direction::Up};
+    int c{'\0'};
     std::vector<Utils::Position> snake;
     int length{10};
     int score{0};
@@ -257,15 +399,15 @@ void Movies::snake()
     int timeOut{60};
     while(c!='q')
     {   
-        setText(w,pos.y,pos.x," ");
+        screen.text(pos.y,pos.x," ");
         snake.push_back(pos);
 
         if(Utils::rng(0,100) < 50 && totalCookies < cookieLimit)
         {
             const auto[y1,y2]{Utils::getTwoRngs(1,height-2)};
             const auto[x1,x2]{Utils::getTwoRngs(1,width-2)};
-            setText(w,y1,x1,"o");
-            setText(w,y2,x2,"o");
+            screen.text(y1,x1,"o");
+            screen.text(y2,x2,"o");
             totalCookies+=2;
         }
         dir = updateDirection(c,dir);
@@ -280,13 +422,13 @@ void Movies::snake()
         pos.y = Utils::wrapAround(pos.y,1,height-2);
         pos.x = Utils::wrapAround(pos.x,1,width-2);
 
-        if(mvwinch(w,pos.y,pos.x) =='*')
+        if(screen.at(pos.y,pos.x) == '*')
         {
             if(score > 0)
                 m_scores.push_back({score,Utils::timeStamp()});
             break;
         }         
-        if(mvwinch(w,pos.y,pos.x) == 'o')
+        if(screen.at(pos.y,pos.x) == 'o')
         {
             length+=5;
             ++score;
@@ -294,206 +436,438 @@ void Movies::snake()
             ++cookieLimit;
         }
 
-        setText(w,0,2,("[\tScore: "+std::to_string(score)+"\t]").c_str());
+        screen.text(0,2,"[ Score: "+std::to_string(score)+" ]");
         while(snake.size() > length)
         {
             auto beg{snake.begin()};
-            setText(w,beg->y,beg->x," ");
+            screen.text(beg->y,beg->x," ");
             snake.erase(beg);
         }
 
         for(const auto[y,x] : snake)
-            setText(w,y,x,"*"); 
+            screen.text(y,x,"*"); 
 
-        wrefresh(w);
+        screen.present();
         timeout(timeOut);
-        c = getch();
+        c = Session::key();
     }
-    setText(w,height-3,width/2,c == 'q' ? "GAME QUIT" : "GAME OVER");
-    setText(w,height-2,width/2 - 5,"Any key to return");
+    screen.text(height-3,width/2,c == 'q' ? "GAME QUIT" : "GAME OVER");
+    screen.text(height-2,width/2 - 5,"Any key to return");
     std::sort(m_scores.begin(),m_scores.end(),[](const Score& s1, const Score& s2){ return s1.score > s2.score; });
-    wattron(w,A_UNDERLINE);
+    screen.attributesOn(A_UNDERLINE);
 
     for(int i=0; i<m_scores.size() && i<height-4; ++i)
     {
-        const auto currentScore{m_scores[i].score};
-        const auto str{std::to_string(currentScore)+"\t"+m_scores[i].timestamp};
-        setText(w,i+2,2,str.c_str());
+        char str[64];
+        std::snprintf(str,sizeof(str),"%-6d%s",m_scores[i].score,m_scores[i].timestamp.c_str());
+        screen.text(i+2,2,str);
     }    
 
-    if(score == m_scores.front().score)
+    if(!m_scores.empty() && score == m_scores.front().score)
     {
-        wattron(w,COLOR_PAIR(MAGENTA));
-        setText(w,0,2,"NEW HIGHSCORE");
+        screen.attributesOn(COLOR_PAIR(MAGENTA));
+        screen.text(0,2,"NEW HIGHSCORE");
     }
     timeout(-1);
-    wrefresh(w);
-    getch();
+    screen.present();
+    Session::key();
     delwin(w);
 }
 
 void Movies::gameOfLife()
 {
+    const Session::View view{"life"};
     constexpr auto xStart{21};
     const auto width{COLS-xStart-3};
     const auto height{LINES-2};
     auto w{ newwin(height,width,1,xStart+2) };
+    Screen screen{w,m_renderer};
     char c{'\0'};
-    constexpr auto cellChar{'X'};
     constexpr auto cellStr{"X"};
-    static_assert(cellStr[0]==cellChar,"Use same character for these");
-    enum class Status{Dead,Alive};
-    std::vector<std::vector<Status>> backPane;
+    Life life{height,width};
     Utils::Queue<int> lastElements{5};
-    for(int i=0; i<height; ++i)
-    {
-        backPane.push_back(std::vector<Status>{});
-        for(int j=0; j<width; j++)
-            backPane[i].push_back(Utils::rng(0,10) < 6 ? Status::Dead : Status::Alive);
-
-    }
-    box(w,0,0);
-    wrefresh(w);
+    screen.outline();
+    screen.present();
     timeout(30);
+    static const auto frameZone{Profiler::zone("life.frame")};
+    static const auto drawZone{Profiler::zone("life.draw")};
+    static const auto stepZone{Profiler::zone("life.step")};
     int loops{0};
+    auto overlay{false};
     while(c!='q')
     {
-        auto timer{ Utils::Timer{}};
+        const auto frameStart{Profiler::now()};
         loops++;
         int liveCount{0};
         for(int y=1; y<height-1; ++y)
             for(int x=1; x<width-1; ++x)
             {
-                const auto alive{backPane[y][x]==Status::Alive};
+                const auto alive{life.alive(y,x)};
                 liveCount+=alive;
-                setText(w,y,x,alive ? cellStr : " ");
+                screen.text(y,x,alive ? cellStr : " ");
             }
+        const auto drawEnd{Profiler::now()};
+        Profiler::record(drawZone,frameStart,drawEnd);
 
         lastElements.add(liveCount);;
         if(loops > 5 && std::all_of(lastElements.begin(),lastElements.end(),[&lastElements](int i){ return i==lastElements.get(0);}))
             break;
 
-        for(int y=1; y<backPane.size(); ++y)
-            for(int x=1; x<backPane[y].size(); ++x)
-            {
-                int neighbours{0};
-                for(int innerY = y-1; innerY < y+2; ++innerY)
-                    for(int innerX = x-1; innerX < x+2; ++innerX)
-                    {
-                        if(innerX==x && innerY==y)
-                            continue;
-                        if(mvwinch(w,innerY,innerX)==cellChar)
-                            neighbours++;
-                    }
-
-                const auto newState{mvwinch(w,y,x)==cellChar ? (neighbours>1 && neighbours<4) : (neighbours==3)};
-                backPane[y][x] = newState ? Status::Alive : Status::Dead;
-            }
+        life.step();
+        const auto stepEnd{Profiler::now()};
+        Profiler::record(stepZone,drawEnd,stepEnd);
+        Profiler::record(frameZone,frameStart,stepEnd);
+
+        Profiler::collect();
+        char renderer[48];
+        if(screen.frames())
+            std::snprintf(renderer,sizeof(renderer),"%s, %zu B/frame",Screen::name(screen.renderer()),screen.bytes()/screen.frames());
+        else
+            std::snprintf(renderer,sizeof(renderer),"%s",Screen::name(screen.renderer()));
+        char status[96];
+        std::snprintf(status,sizeof(status),"[ Live: %d, i: %d, t: %.3fms, %s ]",liveCount,loops,Profiler::stats()[frameZone].lastNs/1e6,renderer);
+        screen.text(0,2,status);
+        if(overlay)
+            drawProfiler(screen,2,2);
+        c = Session::key();
+        if(c == 'p')
+            overlay = !overlay;
+        screen.present();
+    }
+    timeout(-1);
+    screen.attributesOn(COLOR_PAIR(RED));
+    screen.text(height/2,width/2-5,"Terminated");
+    screen.present();
+    Session::key();
+    delwin(w);
+}
 
-        setText(w,0,2,("[ Live: "+std::to_string(liveCount)+",\ti:"+std::to_string(loops)+"\tt:"+timer.get()+" ]").c_str());
-        c = getch();
+void Movies::profiler()
+{
+    const Session::View view{"profiler"};
+    constexpr auto xStart{21};
+    const auto width{COLS-xStart-3};
+    const auto height{LINES-2};
+    auto w{ newwin(height,width,1,xStart+2)};
+    wattron(w,COLOR_PAIR(CYAN));
+    Screen screen{w,Screen::Renderer::Curses};
+    timeout(500);
+    int c{'\0'};
+    while(c!='q')
+    {
+        Profiler::collect();
+        cleanup(w,height,width);
+        drawProfiler(screen,2,2);
+        if(c == 'e' || c == 'E')
+            setText(w,height-4,2,Profiler::exportTrace(TraceFilename) ? "Exported trace.json" : "Could not write trace.json");
+        else if(c == 'r' || c == 'R')
+            Profiler::reset();
+        setText(w,height-2,2,"E = Export trace, R = Reset, Q = Back");
+        box(w,0,0);
+        setText(w,0,2,("[ PROFILER, dropped samples: "+std::to_string(Profiler::dropped())+" ]").c_str());
         wrefresh(w);
+        c = Session::key();
     }
     timeout(-1);
-    wattron(w,COLOR_PAIR(RED));
-    setText(w,height/2,width/2-5,"Terminated");
-    wrefresh(w);
-    getch();
     delwin(w);
 }
 
-void Movies::graph()
+void Movies::drawProfiler(Screen& screen, int y, int x)
+{
+    char line[96];
+    std::snprintf(line,sizeof(line),"%-16s %8s %10s %10s %10s","ZONE","COUNT","P50 us","P99 us","MAX us");
+    screen.text(y++,x,line);
+    for(const auto& zone : Profiler::stats())
+    {
+        const auto& histogram{zone.histogram};
+        std::snprintf(line,sizeof(line),"%-16s %8llu %10.1f %10.1f %10.1f",zone.name.c_str(),
+            static_cast<unsigned long long>(histogram.count()),
+            histogram.percentile(0.5)/1e3,histogram.percentile(0.99)/1e3,histogram.max()/1e3);
+        screen.text(y++,x,line);
+    }
+}
+
+void Movies::memory()
 {
+    const Session::View view{"memory"};
     constexpr auto xStart{21};
     const auto width{COLS-xStart-3};
     const auto height{LINES-2};
     auto w{ newwin(height,width,1,xStart+2)};
-    box(w,0,0);
-    auto A{7};
-    auto B{M_PI*3};
-    char c{'\0'};
+    wattron(w,COLOR_PAIR(CYAN));
+    timeout(500);
+    int c{'\0'};
     while(c!='q')
     {
-        timeout(60);
-        for(int i=0; i<100; ++i)
-        {
-            c = getch();
-            if(c=='q')
-            {    
-                timeout(-1);
-                delwin(w);
-                return;
-            }
+        if(c == 't' || c == 'T')
+            Allocations::enable(!Allocations::enabled());
+        else if(c == 'r' || c == 'R')
+            Allocations::reset();
+        cleanup(w,height,width);
+        drawAllocations(w,2,2,height-4);
+        setText(w,height-2,2,"T = Toggle accounting, R = Reset, Q = Back");
+        box(w,0,0);
+        setText(w,0,2,Allocations::enabled() ? "[ MEMORY, accounting on ]" : "[ MEMORY, accounting off ]");
+        wrefresh(w);
+        c = Session::key();
+    }
+    timeout(-1);
+    delwin(w);
+}
 
-            for(int x=1; x<width-1; ++x)
-            {
-                switch(c)
-                {
-                    case 'w': ++A; c = '\0'; break;
-                    case 's': --A; c = '\0'; break;
-                    case 'a': B-= 1.0*M_PI/180.0; c = '\0'; break;
-                    case 'd': B+= 1.0*M_PI/180.0; c = '\0'; break;
-                }
-                A = std::clamp(A,1,height/2-1);
-                const auto y{ A * std::sin(180/(M_PI*2)*B*x+i)};
-                setText(w,y+height/2,x,"*");
-            }
-            setText(w,0,2,("Amp: "+std::to_string(A)+",\tfreq: "+std::to_string(B/M_PI).substr(0,6)+"pi").c_str());
-            wrefresh(w);
-            cleanup(w,height,width);
+void Movies::drawAllocations(WINDOW* w, int y, int x, int lastLine)
+{
+    char line[128];
+    std::snprintf(line,sizeof(line),"%-16s %8s %10s %9s %10s %10s %10s","SCOPE","ENTRIES","ALLOCS","PER ENTRY","BYTES","LIVE","PEAK");
+    setText(w,y++,x,line);
+    const auto draw{[&](const Allocations::Stats& stats, bool scope){
+        if(y >= lastLine)
+            return;
+        const auto perEntry{scope && stats.entries ? std::to_string(stats.allocations/stats.entries) : std::string{"-"}};
+        std::snprintf(line,sizeof(line),"%-16s %8s %10llu %9s %10s %10s %10s",stats.name,
+            scope ? std::to_string(stats.entries).c_str() : "-",static_cast<unsigned long long>(stats.allocations),perEntry.c_str(),
+            Utils::storage(stats.bytesAllocated).c_str(),stats.live < 0 ? "-" : Utils::storage(stats.live).c_str(),Utils::storage(stats.peak).c_str());
+        setText(w,y++,x,line);
+    }};
+    draw(Allocations::total(),false);
+    for(const auto& stats : Allocations::threads())
+        draw(stats,false);
+    y++;
+    for(const auto& stats : Allocations::tags())
+        draw(stats,true);
+}
+
+// Live and catalog-wide series through the plotter. W/S picks the series and M switches between min-max and LTTB downsampling.
+void Movies::graph()
+{
+    ALLOCATION_SCOPE("graph");
+    const Session::View view{"graph"};
+    finishLoading();
+    constexpr auto xStart{21};
+    const auto width{COLS-xStart-3};
+    const auto height{LINES-2};
+    auto w{ newwin(height,width,1,xStart+2)};
+    Screen screen{w,m_renderer};
+
+    struct Source
+    {
+        const char* name;
+        Plot::Series series;
+    };
+    std::array<Source,4> sources{{{"Frame time, ms"},{"Allocations per second"},{"Ratings by rank"},{"Rating distribution"}}};
+    auto& frameTimes{sources[0].series};
+    auto& allocationRate{sources[1].series};
+    for(std::size_t rank=0; rank<m_ranking.size(); ++rank)
+        sources[2].series.append(static_cast<double>(rank),m_ratings[m_ranking[rank]]);
+    if(!m_movies.empty())
+    {
+        // At most 1000 buckets of one rating point or wider, between the lowest and highest rating.
+        const auto lowest{m_ratings[m_ranking[m_ranking.size()-1]]};
+        const auto highest{m_ratings[m_ranking[0]]};
+        const auto buckets{static_cast<std::size_t>(std::clamp(std::ceil(highest-lowest),1.0,1000.0))};
+        const auto bucketWidth{std::max(highest-lowest,1.0)/buckets};
+        std::vector<std::size_t> counts(buckets);
+        for(MovieId id=0; id<m_movies.size(); ++id)
+            ++counts[std::min(static_cast<std::size_t>((m_ratings[id]-lowest)/bucketWidth),buckets-1)];
+        for(std::size_t i=0; i<buckets; ++i)
+            sources[3].series.append(lowest+(i+0.5)*bucketWidth,static_cast<double>(counts[i]));
+    }
+
+    Plot::Canvas canvas;
+    Plot::Plotter plotter;
+    auto method{Plot::Method::MinMax};
+    std::size_t selected{0};
+    const auto opened{std::chrono::steady_clock::now()};
+    auto sampled{opened};
+    auto allocations{Allocations::total().allocations};
+    std::chrono::duration<double,std::milli> frameCost{};
+    timeout(33);
+    int c{0};
+    while(c != 'q')
+    {
+        const auto frameStart{std::chrono::steady_clock::now()};
+        const auto seconds{std::chrono::duration<double>(frameStart-opened).count()};
+        if(frameCost.count() > 0)
+            frameTimes.append(seconds,frameCost.count());
+        if(frameStart-sampled >= 250ms)
+        {
+            const auto total{Allocations::total().allocations};
+            allocationRate.append(seconds,(total-allocations)/std::chrono::duration<double>(frameStart-sampled).count());
+            allocations = total;
+            sampled = frameStart;
+        }
+        const auto& source{sources[selected]};
+        drawSeries(screen,canvas,plotter,source.series,method,2,height-3);
+        screen.outline();
+        char title[256];
+        std::snprintf(title,sizeof(title),"[ %s%s, %zu points, %zu drawn, %s, %.2f ms/frame  W/S = Series, M = Method, H = History ]",
+            source.name,&source.series == &allocationRate && !Allocations::enabled() ? " (accounting off)" : "",source.series.size(),
+            plotter.drawn(),method == Plot::Method::MinMax ? "min-max" : "LTTB",frameCost.count());
+        screen.text(0,2,title);
+        screen.present();
+        frameCost = std::chrono::steady_clock::now()-frameStart;
+        switch(c = Session::key())
+        {
+            IfKeyUp: selected = (selected+sources.size()-1)%sources.size(); break;
+            IfKeyDown: selected = (selected+1)%sources.size(); break;
+            case 'm':
+            case 'M':
+                method = method == Plot::Method::MinMax ? Plot::Method::Lttb : Plot::Method::MinMax;
+                break;
+            case 'h':
+            case 'H':
+                screen.release();
+                ratingHistory(w,height,width);
+                timeout(33);
+                break;
+            default: break;
         }
+        screen.blank();
     }
     timeout(-1);
     delwin(w);
 }
+
+// The biggest rating movers over the last day, week, month or year, and the trajectory of the selected one.
+void Movies::ratingHistory(WINDOW* w, int height, int width)
+{
+    const Session::View view{"history"};
+    finishLoading();
+    timeout(-1);
+    constexpr std::array Days{1,7,30,365};
+    constexpr std::size_t Listed{5};
+    std::size_t days{1};
+    std::size_t selected{0};
+    Plot::Canvas canvas;
+    Plot::Plotter plotter;
+    Plot::Series trajectory;
+    Screen screen{w,Screen::Renderer::Curses};
+    int c{0};
+    while(c != 'q')
+    {
+        const auto now{RatingHistory::now()};
+        const auto from{now-RatingHistory::Time{Days[days]}*24*60*60};
+        const auto movers{m_history.movers(from,Listed)};
+        selected = std::min(selected,movers.empty() ? 0 : movers.size()-1);
+        werase(w);
+        for(std::size_t i=0; i<movers.size(); ++i)
+        {
+            const auto& mover{movers[i]};
+            const auto change{static_cast<int>(std::lround(mover.to-mover.from))};
+            const auto title{mover.id < m_movies.size() ? std::string{name(mover.id)}+" ("+std::to_string(m_movies[mover.id].year)+")"
+                                                        : "#"+std::to_string(mover.id)};
+            char line[256];
+            std::snprintf(line,sizeof(line),"%+5d  %.*s  %.0f -> %.0f",change,std::max(0,width-40),title.c_str(),mover.from,mover.to);
+            if(i == selected)
+                wattron(w,A_STANDOUT);
+            setText(w,static_cast<int>(i)+1,2,line);
+            wattroff(w,A_STANDOUT);
+        }
+        const auto top{static_cast<int>(Listed)+2};
+        if(movers.empty())
+            setText(w,top,2,("No rating changes in the last "+std::to_string(Days[days])+" days").c_str());
+        else
+        {
+            // Steps in days before now: each rating holds until the next one replaces it.
+            const auto& mover{movers[selected]};
+            const auto day{[now](RatingHistory::Time time){ return static_cast<double>(time-now)/(24*60*60); }};
+            trajectory.clear();
+            trajectory.append(day(from),mover.from);
+            m_history.forEach(mover.id,from,now,[&](RatingHistory::Time time, double rating){
+                trajectory.append(day(time),trajectory.back().y);
+                trajectory.append(day(time),rating);
+            });
+            trajectory.append(0,trajectory.back().y);
+            drawSeries(screen,canvas,plotter,trajectory,Plot::Method::MinMax,top,height-3);
+        }
+        box(w,0,0);
+        setText(w,0,2,("[ Rating history, last "+std::to_string(Days[days])+" days, "+std::to_string(m_history.points())+" points in "
+                       +Utils::storage(m_history.bytes())+"  W/S = Movie, A/D = Period, Q = Back ]").c_str());
+        wrefresh(w);
+        switch(c = Session::key())
+        {
+            IfKeyUp: selected -= selected > 0; break;
+            IfKeyDown: ++selected; break;
+            IfKeyLeft: days -= days > 0; break;
+            IfKeyRight: days += days+1 < Days.size(); break;
+            default: break;
+        }
+    }
+    werase(w);
+}
+
 void Movies::list()
 {
+    ALLOCATION_SCOPE("list");
+    const Session::View view{"list"};
     constexpr auto xStart{21};
     const auto width{COLS-xStart-3};
     const auto height{LINES-2};
     auto w{ newwin(height,width,1,xStart+2)};
     wattron(w,COLOR_PAIR(MAGENTA));
     wattron(w,A_BOLD);
-    List l{4};
-    auto refreshData{[this, w](const decltype(l)& li)
+    using Lists = std::variant<List<int>,UnrolledList<int>,IndexList<int>>;
+    Lists l{std::in_place_index<0>,4};
+    auto refreshData{[this, w](const Lists& li)
     {
         std::stringstream ss;
-        li.print(ss);
-        const auto tokens{Utils::tokenize(ss.str(),'\n')};
-        for(int i=0; i<tokens.size(); ++i)
-            setText(w,1+i,4,tokens[i].c_str());
+        std::visit([&ss](const auto& list){ list.print(ss); },li);
+        const auto text{ss.str()};
+        int y{1};
+        for(const auto line : Utils::Split{text,'\n'})
+            mvwaddnstr(w,y++,4,line.data(),static_cast<int>(line.size()));
         box(w,0,0);
+        setText(w,0,2,"[ A = Append, D = Remove last, 1-9 = Remove, V = Switch list type ]");
         wrefresh(w);
     }};
     refreshData(l);
     char c{'\0'};
     while(c!='q')
     {
-        c = getch();
-        switch(c)
+        c = Session::key();
+        std::visit([c](auto& list)
         {
-        case 'a':
-            l.append(Utils::rng(1,1000));
-            break;
-        case 'd':
-            if(l.size()-1 > 0) // dont delete root
-                l.remove(l.size()-1);
-            break;
+            switch(c)
+            {
+            case 'a':
+                list.append(Utils::rng(1,1000));
+                break;
+            case 'd':
+                if(list.size()-1 > 0) // dont delete root
+                    list.remove(list.size()-1);
+                break;
+            }
+            const auto num{static_cast<int>(c-'0')};
+            if(num >= 1 && num <= 9 && num <= list.size()-1)
+                list.remove(num);
+        },l);
+        if(c == 'v')
+        {
+            std::vector<int> values;
+            std::visit([&values](const auto& list){ list.forEach([&values](int value){ values.push_back(value); }); },l);
+            const auto refill{[&values](auto& list){ for(std::size_t i=1; i<values.size(); ++i) list.append(values[i]); }};
+            switch(l.index())
+            {
+            case 0: refill(l.emplace<1>(values.front())); break;
+            case 1: refill(l.emplace<2>(values.front())); break;
+            default: refill(l.emplace<0>(values.front())); break;
+            }
         }
-        const auto num{static_cast<int>(c-'0')};
-        if(num >= 1 && num <= 9 && num <= l.size()-1)
-            l.remove(num);
         cleanup(w,height,width);
         refreshData(l);
     }
-    l.clear();
+    std::visit([](auto& list){ list.clear(); },l);
     cleanup(w,height,width);
     refreshData(l);
-    std::this_thread::sleep_for(1s);
+    if(!Session::replaying())
+        std::this_thread::sleep_for(1s);
 }
 
 void Movies::reset()
 {
+    const Session::View view{"reset"};
+    if(readOnly())
+        return;
     constexpr auto xStart{21};
     const auto width{COLS-xStart-3};
     const auto height{LINES-2};
@@ -504,60 +878,219 @@ void Movies::reset()
     setText(w,2,1,"Any key to exit");
     setText(w,4,1,"D = Delete");
     setText(w,5,1,"R = Restore");
+    setText(w,6,1,"S = Save snapshot");
+    setText(w,7,1,("B = Fit Bradley-Terry to "+std::to_string(m_comparisons.size())+" comparisons").c_str());
+    if(!m_snapshots.empty())
+        setText(w,9,1,"Snapshots:");
+    for(int i=0; i<m_snapshots.size() && i<9 && i+10<height-1; ++i)
+        setText(w,i+10,1,(std::to_string(i+1)+" = "+m_snapshots[i].name).c_str());
 
     box(w,0,0);
     wrefresh(w);
-    const auto totalMovies{std::to_string(m_movies.size())};
-    switch(getch())
+    const auto c{Session::key()};
+    switch(c)
     {
         case 'D':
         case 'd':
         {
-            for(auto& movie : m_movies)
-            {
-                m_ratingCache[movie.name] = movie.rating;
-                movie.rating = 1000;
-            }
-            setText(w,7,1,("Reset "+totalMovies+" movies rating to 1000").c_str());
+            // Rows still loading would otherwise be adopted later with their file ratings.
+            finishLoading();
+            takeSnapshot("Before reset");
+            m_ratings.fill(1000);
+            m_ranking.rebuild(m_movies.size(),ratingOf());
+            m_completions.refresh(ratingOf());
+            m_years.refresh(ratingOf());
+            setText(w,8,1,("Reset "+std::to_string(m_movies.size())+" movies rating to 1000").c_str());
             break;
         }
         case 'R':
         case 'r':
         {
-            if(m_ratingCache.empty())
+            if(m_snapshots.empty())
                 break;
-
-            std::vector<Movie> restoredMovies;
-            Utils::Queue<Movie> queue(height-2);
-            for(auto& movie : m_movies)
-                if(const auto it{ m_ratingCache.find(movie.name) }; it != m_ratingCache.end()) [[likely]]
+            showRestored(w,switchRatings(m_snapshots.back().ratings));
+            break;
+        }
+        case 'B':
+        case 'b':
+        {
+            // The fit replaces the ratings of every compared movie; movies never compared keep theirs.
+            finishLoading();
+            takeSnapshot("Before fit");
+            BradleyTerry model{m_movies.size(),m_comparisons};
+            const auto result{model.fit()};
+            std::size_t fitted{0};
+            for(MovieId id=0; id<m_movies.size(); ++id)
+                if(model.compared(id))
                 {
-                    movie.rating = it->second;
-                    restoredMovies.push_back(movie);
-                    queue.add(movie);
-                    std::string blank;
-                    blank.resize(width-2,' ');
-                    if(std::next(it) != m_ratingCache.end()) [[likely]]
-                        for(int i=1; i<=queue.size(); ++i)
-                            setText(w,i,1,blank.c_str());
-                    auto count {1};
-                    for(auto element : queue)
-                    {   
-                        setText(w,count++,12,("Restored "+element.name+" rating to "+std::to_string(element.rating).substr(0,6)).c_str());
-                        wrefresh(w);
-                    }
-                    std::this_thread::sleep_for(20ms);
-                }            
+                    const auto previous{m_ratings[id]};
+                    m_ratings.set(id,model.rating(id));
+                    recordRating(id,previous);
+                    ++fitted;
+                }
+            m_ranking.rebuild(m_movies.size(),ratingOf());
+            m_completions.refresh(ratingOf());
+            m_years.refresh(ratingOf());
+            setText(w,8,1,("Fitted "+std::to_string(fitted)+" movies in "+std::to_string(result.iterations)+" iterations"
+                           +(result.converged ? "" : ", not converged")).c_str());
+            break;
+        }
+        case 'S':
+        case 's':
+        {
+            setText(w,8,1,"Name: ");
+            wrefresh(w);
+            if(const auto name{getStrInput(w,8,7)}; !name.empty())
+                takeSnapshot(name);
             break;
         }
         default:
+        {
+            if(c >= '1' && c-'1' < static_cast<int>(m_snapshots.size()) && c <= '9')
+                showRestored(w,switchRatings(m_snapshots[c-'1'].ratings));
+            break;
+        }
+    }
+    wrefresh(w);
+    Session::key();
+    delwin(w);
+}
+
+// Appends the current rating of id to its history, preceded by the rating it replaced if this is its first entry.
+void Movies::recordRating(MovieId id, double previous)
+{
+    const auto now{RatingHistory::now()};
+    if(!m_history.contains(id))
+        m_history.append(id,now,previous);
+    if(m_ratings[id] != previous)
+        m_history.append(id,now,m_ratings[id]);
+}
+
+void Movies::takeSnapshot(const std::string& name)
+{
+    std::erase_if(m_snapshots,[&name](const Snapshot& snapshot){ return snapshot.name == name; });
+    m_snapshots.push_back({name,m_ratings});
+}
+
+std::vector<MovieId> Movies::switchRatings(const Ratings& ratings)
+{
+    std::vector<MovieId> changed;
+    ratings.forEachDiff(m_ratings,[&changed](MovieId id, double, double){ changed.push_back(id); });
+    const auto previous{m_ratings};
+    m_ratings = ratings;
+    // movies added after the snapshot was taken keep their current rating
+    for(auto id{m_ratings.size()}; id<m_movies.size(); ++id)
+        m_ratings.push_back(previous[id]);
+
+    if(changed.size()*16 < m_movies.size())
+    {
+        m_ranking.update(changed,ratingOf(),[&previous](MovieId id){ return previous[id]; });
+        for(const auto id : changed)
+            m_completions.update(id,m_ratings[id]);
+        m_years.update(changed,ratingOf());
+    }
+    else
+    {
+        m_ranking.rebuild(m_movies.size(),ratingOf());
+        m_completions.refresh(ratingOf());
+        m_years.refresh(ratingOf());
+    }
+    return changed;
+}
+
+void Movies::showRestored(WINDOW* w, const std::vector<MovieId>& restored)
+{
+    // The listing plays over a bounded number of frames no matter how many movies changed
+    constexpr auto MaxFrames{60};
+    constexpr auto FrameTime{16ms};
+    int height, width;
+    getmaxyx(w,height,width);
+    cleanup(w,height,width);
+
+    Utils::Queue<MovieId> queue(height-2);
+    const auto perFrame{std::max<std::size_t>(1,restored.size()/MaxFrames)};
+    std::string blank;
+    blank.resize(width-2,' ');
+    timeout(0);
+    for(std::size_t i=0; i<restored.size();)
+    {
+        const auto frameEnd{std::chrono::steady_clock::now()+FrameTime};
+        for(const auto last{std::min(i+perFrame,restored.size())}; i<last; ++i)
+            queue.add(restored[i]);
+
+        auto count {1};
+        for(const auto id : queue)
+        {
+            setText(w,count,1,blank.c_str());
+            setText(w,count++,12,("Restored "+std::string{name(id)}+" rating to "+std::to_string(m_ratings[id]).substr(0,6)).c_str());
+        }
+        wrefresh(w);
+        if(Session::key() != ERR)
             break;
+        if(!Session::replaying())
+            std::this_thread::sleep_until(frameEnd);
+    }
+    timeout(-1);
+    setText(w,0,2,("[ Restored "+std::to_string(restored.size())+" movies ]").c_str());
+}
+
+void Movies::profiles()
+{
+    const Session::View view{"profiles"};
+    if(readOnly())
+        return;
+    finishLoading();
+    constexpr auto xStart{21};
+    const auto width{COLS-xStart-3};
+    const auto height{LINES-2};
+    auto w{ newwin(height,width,1,xStart+2)};
+    wattron(w,COLOR_PAIR(YELLOW));
+    wattron(w,A_BOLD);
+
+    setText(w,2,1,"Any key to exit");
+    setText(w,4,1,"B = Branch active profile");
+    setText(w,5,1,"1-9 = Switch profile");
+    const auto names{m_profiles.names()};
+    for(int i=0; i<names.size() && i<9 && i+9<height-1; ++i)
+        setText(w,i+9,1,(std::to_string(i+1)+(names[i] == m_profiles.active() ? " * " : " = ")+names[i]).c_str());
+
+    box(w,0,0);
+    setText(w,0,2,"PROFILES");
+    wrefresh(w);
+    const auto c{Session::key()};
+    if(c == 'B' || c == 'b')
+    {
+        setText(w,7,1,"Name: ");
+        wrefresh(w);
+        const auto name{getStrInput(w,7,7)};
+        if(!name.empty() && !m_profiles.contains(name) && name.find('/') == std::string::npos)
+        {
+            m_profiles.store(m_profiles.active(),m_ratings);
+            m_profiles.store(name,m_ratings);
+            m_profiles.setActive(name);
+            setText(w,7,1,("Branched "+name+" from active profile").c_str());
+        }
+        else
+            setText(w,7,1,"Invalid or existing profile name.");
+    }
+    else if(c >= '1' && c <= '9' && c-'1' < static_cast<int>(names.size()))
+    {
+        const auto changed{switchProfile(names[c-'1'])};
+        setText(w,7,1,("Switched to "+m_profiles.active()+", "+std::to_string(changed)+" ratings differ").c_str());
     }
     wrefresh(w);
-    getch();
+    Session::key();
     delwin(w);
 }
 
+std::size_t Movies::switchProfile(const std::string& name)
+{
+    m_profiles.store(m_profiles.active(),m_ratings);
+    const auto changed{switchRatings(m_profiles.load(name,m_movies.size()))};
+    m_profiles.setActive(name);
+    return changed.size();
+}
+
 void Movies::shutdown()
 {
     attron(COLOR_PAIR(CYAN));
@@ -568,7 +1101,8 @@ void Movies::shutdown()
         for(int x=0; x<COLS; ++x)
             setText(stdscr,y,x," ");
         refresh();
-        std::this_thread::sleep_for(15ms);
+        if(!Session::replaying())
+            std::this_thread::sleep_for(15ms);
     }
     m_exitCode = endwin();
 }
@@ -582,7 +1116,7 @@ std::string Movies::getStrInput(WINDOW* win, int y, int x, int color, bool bold)
         std::string blank;
         blank.resize(str.size(),' ');
         setText(win,y,x,blank.c_str());
-        c=getch();
+        c=Session::key();
         if(Utils::backspace(c))
         {
             if(!str.empty())
@@ -597,53 +1131,130 @@ std::string Movies::getStrInput(WINDOW* win, int y, int x, int color, bool bold)
         box(win,0,0);
         wrefresh(win);
     }
-    if(str.back()=='\n')
+    if(!str.empty() && str.back()=='\n')
         str.pop_back();
     return str;
 }
 
 void Movies::browse()
 {
+    ALLOCATION_SCOPE("browse");
+    const Session::View view{"browse"};
+    if(m_archive)
+        return remoteBrowse(*m_archive);
+    if(m_client)
+        return remoteBrowse(*m_client);
     constexpr auto xStart{17+4};
     auto w{ newwin(LINES-2,COLS-xStart-3,1,xStart+2) };
     wattron(w,COLOR_PAIR(YELLOW));
 
+    // With a filter active the rows are streamed from the year index; the cursor is kept between
+    // frames so scrolling down only advances it, and only scrolling up restarts the merge.
+    std::optional<YearIndex::Filter> filter;
+    std::string filterText;
+    using Matches = decltype(m_years.query(YearIndex::Filter{},ratingOf()));
+    std::optional<Matches> matches;
+    int matchesShift{0};
+    const auto countMovies{[this,&filter]{
+        return static_cast<int>(filter ? m_years.count(*filter,ratingOf()) : m_movies.size());
+    }};
+
     auto shift{0};
-    const auto lastMovie{static_cast<int>(m_movies.size()-1)};
-    const auto drawMovies{[this,&w,&lastMovie](int shift)
+    auto lastMovie{countMovies()-1};
+    const auto drawMovies{[&](int shift)
     {
-        if(shift>=m_movies.size()-1)
-            return;
-        for(int y=0; y<m_movies.size(); y++)
-        {
-            const int adjustedShift{ std::clamp(y+shift,0,lastMovie) };
-            const auto& currentMovie{m_movies[adjustedShift]};
-            std::string bigSpace; bigSpace.resize(COLS-xStart-4,' ');
+        PROFILE_ZONE("browse.draw");
+        const auto rows{std::max(0,std::min(lastMovie+1-shift,LINES-3))};
+        std::string bigSpace; bigSpace.resize(COLS-xStart-4,' ');
+        const auto drawRow{[&](int y, MovieId id){
             setText(w,y+1,0,bigSpace.c_str());
-            setText(w,y+1,2,(std::to_string(adjustedShift+1)+"\t"+displayString(currentMovie)).c_str()); 
+            setText(w,y+1,2,(std::to_string(shift+y+1)+"\t"+displayString(movie(id))).c_str());
+        }};
+        if(filter)
+        {
+            if(!matches || shift < matchesShift)
+            {
+                matches.emplace(m_years.query(*filter,ratingOf()));
+                matchesShift = 0;
+            }
+            matches->skip(shift-matchesShift);
+            matchesShift = shift;
+            auto page{*matches};
+            MovieId id;
+            for(int y=0; y<rows && page.next(id); ++y)
+                drawRow(y,id);
+        }
+        else
+        {
+            for(int y=0; y<rows; ++y)
+                drawRow(y,m_ranking[shift+y]);
         }
+        for(int y=rows; y<LINES-4; ++y)
+            setText(w,y+1,0,bigSpace.c_str());
     }};
     drawMovies(shift);
     box(w,0,0);
 
-    const std::string title{std::to_string(m_movies.size())+" movies loaded."};
+    const auto browseTitle{[&]{
+        const auto shown{filter ? std::to_string(lastMovie+1)+" of " : std::string{}};
+        return shown+std::to_string(m_movies.size())+" movies"+(filter ? " matching "+filterText : " loaded")
+            +". Profile: "+m_profiles.active()+loadingStatus()+"  F = Filter";
+    }};
+    auto title{browseTitle()};
     setText(w,0,2,title.c_str());
     mvwchgat(w,0,2,title.size(),A_BOLD,COLOR_PAIR(YELLOW),nullptr);
     wrefresh(w);
-    char c{'\0'};
+    int c{'\0'};
     int pos{0};
     int traversal{1};
     while(c!='q')
     {
-        c = getch();
+        c = waitKey();
+        if(c == ERR)
+        {
+            if(!adoptLoaded() && title == browseTitle())
+                continue;
+            matches.reset();
+            lastMovie = countMovies()-1;
+            title = browseTitle();
+            werase(w);
+        }
         setText(w,pos,0," ");
         mvwchgat(w,pos,0,1,A_NORMAL,COLOR_PAIR(YELLOW),nullptr);
         switch (c)
         {
+            case ERR:   { break; }
             IfKeyDown:  { pos++; break; }     
             IfKeyUp:    { pos--; break; }
             IfKeyRight: { pos+=10; break; }
             IfKeyLeft:  { pos-=10; break; }
+            case 'F':
+            case 'f':
+            {
+                filter = editFilter();
+                filterText.clear();
+                if(filter)
+                {
+                    constexpr YearIndex::Filter open;
+                    const auto bounds{[](auto low, auto high, auto openLow, auto openHigh){
+                        if(low == high)
+                            return std::to_string(static_cast<int>(low));
+                        if(high == openHigh)
+                            return low == openLow ? std::string{"any"} : std::to_string(static_cast<int>(low))+"+";
+                        return (low == openLow ? std::string{} : std::to_string(static_cast<int>(low)))+"-"+std::to_string(static_cast<int>(high));
+                    }};
+                    filterText = "years "+bounds(filter->fromYear,filter->toYear,open.fromYear,open.toYear)
+                        +", rating "+bounds(filter->minRating,filter->maxRating,open.minRating,open.maxRating);
+                }
+                matches.reset();
+                shift = 0;
+                pos = 1;
+                lastMovie = countMovies()-1;
+                title = browseTitle();
+                touchwin(w);
+                werase(w);
+                break;
+            }
             default :   { search(); return; }
         }
         if(pos < 1)
@@ -658,13 +1269,13 @@ void Movies::browse()
             if(shift+pos < lastMovie+1)
                 shift++;
         }
-        shift = std::clamp(shift,0,lastMovie);
+        shift = std::clamp(shift,0,std::max(lastMovie,0));
         drawMovies(shift);
         box(w,0,0);
         setText(w,0,2,title.c_str());
         mvwchgat(w,0,2,title.size(),A_BOLD,COLOR_PAIR(YELLOW),nullptr);
         setText(w,pos,0,">");
-        traversal = std::max(1,static_cast<int>((shift+pos)/static_cast<double>(lastMovie) * (LINES-4)));
+        traversal = std::max(1,static_cast<int>((shift+pos)/static_cast<double>(std::max(lastMovie,1)) * (LINES-4)));
         setText(w,traversal,COLS-xStart-3-1,"+");
         mvwchgat(w,pos,0,1,A_STANDOUT,COLOR_PAIR(YELLOW),nullptr);
         wrefresh(w);
@@ -672,8 +1283,33 @@ void Movies::browse()
     delwin(w);
 }
 
+// Asks for a year and rating range; returns no filter when both are left empty or cannot be parsed.
+std::optional<YearIndex::Filter> Movies::editFilter()
+{
+    auto w{ newwin(7,globalWidth,4,21) };
+    wattron(w,COLOR_PAIR(YELLOW));
+    setText(w,1,2,"Years:");
+    setText(w,2,2,"Rating:");
+    setText(w,4,2,"e.g. 1970-1979, 1994 or 2000+. Empty fields match everything.");
+    box(w,0,0);
+    wrefresh(w);
+    YearIndex::Filter filter;
+    const auto years{getStrInput(w,1,10)};
+    const auto rating{getStrInput(w,2,10)};
+    delwin(w);
+    if(years.empty() && rating.empty())
+        return std::nullopt;
+    if(!parseRange(std::string_view{years},filter.fromYear,filter.toYear) || !parseRange(std::string_view{rating},filter.minRating,filter.maxRating))
+        return std::nullopt;
+    return filter;
+}
+
 void Movies::addMovie()
 {
+    const Session::View view{"add"};
+    if(readOnly())
+        return;
+    finishLoading();
     auto w{ newwin(11,globalWidth,2,21) };
     wattron(w,COLOR_PAIR(RED));
     setText(w,1,2,"Name:");
@@ -691,14 +1327,18 @@ void Movies::addMovie()
         newMovie.name.pop_back();
 
     std::optional<Movie> potentialMatch;
-    for(const auto& movie : m_movies)
-        if(Utils::stringEquals(movie.name,newMovie.name))
-            potentialMatch = movie;
+    for(MovieId id=0; id<m_movies.size(); ++id)
+        if(Utils::stringEquals(std::string{name(id)},newMovie.name))
+            potentialMatch = movie(id);
 
     if(Utils::validYear(newMovie.year) && !potentialMatch)
     {
         newMovie.rating = 1000;
-        m_movies.push_back(newMovie);
+        m_movies.push_back({m_names.intern(newMovie.name),newMovie.year});
+        m_ratings.push_back(newMovie.rating);
+        m_ranking.append(static_cast<MovieId>(m_movies.size()-1),ratingOf());
+        m_completions.insert(static_cast<MovieId>(m_movies.size()-1),titleOf(),ratingOf());
+        m_years.insert(static_cast<MovieId>(m_movies.size()-1),static_cast<MovieId>(m_movies.size()),yearOf(),ratingOf());
     }
     else
     {
@@ -714,13 +1354,19 @@ void Movies::addMovie()
             setText(w,9,2,displayString(match).c_str());
         }
         wrefresh(w);
-        getch();   
+        Session::key();   
     }
     delwin(w);
 }
 
 void Movies::search()
 {
+    ALLOCATION_SCOPE("search");
+    const Session::View view{"search"};
+    if(m_archive)
+        return remoteSearch(*m_archive);
+    if(m_client)
+        return remoteSearch(*m_client);
     auto w{ newwin(LINES-2,globalWidth,1,21) };
     wattron(w,COLOR_PAIR(RED));
     setText(w,1,2,"Search: ");
@@ -735,7 +1381,9 @@ void Movies::search()
         std::string blank;
         blank.resize(str.size(),' ');
         setText(w,2,2,blank.c_str());
-        c=getch();
+        c=waitKey();
+        if(c == ERR && !adoptLoaded())
+            continue;
         if(Utils::backspace(c))
         {
             if(!str.empty())
@@ -744,23 +1392,39 @@ void Movies::search()
         else if(Utils::validAscii(c))
             str+=c;
 
-        if(str.back()=='\n')
+        if(!str.empty() && str.back()=='\n')
             str.pop_back();
 
-        for(const auto& movie : m_movies)
-            if(Utils::stringEquals(movie.name,str))
-                matches.push_back(movie);
+        {
+        PROFILE_ZONE("search.filter");
+        for(const auto id : m_ranking)
+            if(Utils::stringEquals(std::string{name(id)},str))
+                matches.push_back(movie(id));
+        }
 
         std::string blankSpace;
-        blankSpace.resize(globalWidth-2,' ');
-        for(int i=5; i<LINES-2; i++)
+        blankSpace.resize(globalWidth-4,' ');
+        for(int i=4; i<LINES-2; i++)
             setText(w,i,2,blankSpace.c_str());
 
+        int y{4};
+        if(!str.empty())
+        {
+            constexpr auto Suggestions{5};
+            const auto& completions{m_completions.top(str,Suggestions,titleOf(),ratingOf())};
+            if(!completions.empty())
+            {
+                setText(w,y++,2,("Best rated titles starting with \""+str+"\":").c_str());
+                for(const auto id : completions)
+                    setText(w,y++,4,displayString(movie(id)).c_str());
+                ++y;
+            }
+        }
+
         if(!matches.empty())
         {   
             const std::string movieText{matches.size() > 1 ? "Found "+std::to_string(matches.size())+" movies:   " : "Found movie:     "};
-            setText(w,4,2,movieText.c_str());
-            int y{5};
+            setText(w,y++,2,movieText.c_str());
             for(const auto& movie : matches)
             {
                 if(y>=LINES-3)
@@ -771,8 +1435,11 @@ void Movies::search()
         }
         else 
         {
-            setText(w,4,2,"No matches.      ");
+            setText(w,y,2,"No matches.      ");
         }
+        std::string status{loadingStatus()};
+        status.resize(globalWidth-4,' ');
+        setText(w,3,2,status.c_str());
     
         wrefresh(w);
         setText(w,2,2,str.c_str());
@@ -785,9 +1452,15 @@ void Movies::search()
 
 void Movies::rateMovies()
 {
+    ALLOCATION_SCOPE("rateMovies");
+    const Session::View view{"rate"};
+    if(m_client)
+        return remoteRate();
+    if(m_movies.size() < 2)
+        finishLoading();
     const auto[firstNumber,secondNumber]{Utils::getTwoRngs(0,m_movies.size()-1)};
-    const auto firstMovie{m_movies[firstNumber]};
-    const auto secondMovie{m_movies[secondNumber]};
+    const auto firstMovie{movie(firstNumber)};
+    const auto secondMovie{movie(secondNumber)};
     auto w1{ newwin(4,globalWidth,2,21) };
     auto w2{ newwin(4,globalWidth,7,21)};
     wattron(w1,COLOR_PAIR(CYAN));
@@ -803,7 +1476,7 @@ void Movies::rateMovies()
     std::optional<std::pair<double,double>> newRatings;
     auto loop{true};
     while(loop){
-        switch (getch())
+        switch (Session::key())
         {
         IfKeyUp:
         {
@@ -826,6 +1499,13 @@ void Movies::rateMovies()
         IfKeyRight:
         {
             loop = false;
+            if(selection.has_value())
+            {
+                m_comparisons.push_back(*selection ? Comparison{static_cast<MovieId>(firstNumber),static_cast<MovieId>(secondNumber)}
+                                                   : Comparison{static_cast<MovieId>(secondNumber),static_cast<MovieId>(firstNumber)});
+                recordRating(static_cast<MovieId>(firstNumber),firstMovie.rating);
+                recordRating(static_cast<MovieId>(secondNumber),secondMovie.rating);
+            }
             wrefresh(w1);
             wrefresh(w2);
             return;
@@ -841,10 +1521,15 @@ void Movies::rateMovies()
         {
             const auto diff1{ newRatings.value().first - firstMovie.rating };
             const auto diff2{ newRatings.value().second - secondMovie.rating };
-            for(const auto [diff,num,win] : { Diff{diff1,firstNumber,w1}, Diff{diff2,secondNumber,w2}}) 
+            for(const auto [diff,num,win] : { Diff{diff1,static_cast<MovieId>(firstNumber),w1}, Diff{diff2,static_cast<MovieId>(secondNumber),w2}}) 
             {
                 m_ratedMovies[num] += diff;
-                m_movies[num].rating += diff;
+                ++m_ratedGeneration;
+                const auto oldRating{m_ratings[num]};
+                m_ratings.set(num,oldRating+diff);
+                m_ranking.update(num,ratingOf());
+                m_completions.update(num,m_ratings[num]);
+                m_years.update(num,oldRating,ratingOf());
                 const auto diffStr{ "Rating: "+ std::string(diff > 0 ? "+":"") + std::to_string(static_cast<int>(diff)) };
                 setText(win, 2, 2, diffStr.c_str());
             }
@@ -856,30 +1541,301 @@ void Movies::rateMovies()
     delwin(w2);
 }
 
-void Movies::loadMovies()
+// Shows a pair chosen by the server; the comparison is sent once the choice is confirmed.
+void Movies::remoteRate()
 {
-    auto moviefile{std::fstream{Filename}};
-    std::string str;
-    while(std::getline(moviefile,str))
-        if(const auto movie{deserialize<Movie>(str)}; Utils::validYear(movie.year))
-            m_movies.push_back(movie);
+    if(!m_client->good())
+        return;
+    const auto pair{m_client->pair()};
+    auto w1{ newwin(4,globalWidth,2,21) };
+    auto w2{ newwin(4,globalWidth,7,21)};
+    wattron(w1,COLOR_PAIR(CYAN));
+    wattron(w2,COLOR_PAIR(CYAN));
+    std::optional<bool> selection;
+    auto loop{pair.has_value()};
+    if(loop)
+    {
+        setText(w1,1,2,displayString(pair->first.movie, "FIRST:  ").c_str());
+        setText(w2,1,2,displayString(pair->second.movie, "SECOND: ").c_str());
+    }
+    else
+        setText(w1,1,2,("Connection to "+m_client->path()+" lost.").c_str());
+    box(w1,0,0);
+    box(w2,0,0);
+    wrefresh(w1);
+    wrefresh(w2);
+    while(loop)
+    {
+        switch (Session::key())
+        {
+            IfKeyUp:
+            {
+                selection = true;
+                break;
+            }
+            IfKeyDown:
+            {
+                selection = false;
+                break;
+            }
+            IfKeyRight:
+            {
+                loop = false;
+                break;
+            }
+            default:
+                break;
+        }
+        if(!selection.has_value())
+            continue;
+        if(*selection)
+        {
+            wattron(w1,A_STANDOUT);
+            wattroff(w2,A_STANDOUT);
+        }
+        else
+        {
+            wattroff(w1,A_STANDOUT);
+            wattron(w2,A_STANDOUT);
+        }
+        box(w1,0,0);
+        box(w2,0,0);
+        wrefresh(w1);
+        wrefresh(w2);
+    }
+    if(selection.has_value())
+        m_client->rate(pair->first.id,pair->second.id,*selection);
+    else if(!pair)
+        Session::key();
+    delwin(w1);
+    delwin(w2);
+}
+
+// Moves rows the loader has published since the last call into the catalog; true if any were added.
+bool Movies::adoptLoaded()
+{
+    ALLOCATION_SCOPE("catalog.adopt");
+    if(!m_loader)
+        return false;
+    const auto snapshot{m_loader->snapshot()};
+    // Merging into the indexes is linear in the catalog, so partial loads are taken at most four times a second.
+    const auto now{std::chrono::steady_clock::now()};
+    if(!snapshot->done && now-m_lastAdopted < 250ms)
+        return false;
+    m_lastAdopted = now;
+    const auto first{m_movies.size()};
+    for(; m_adoptedChunks<snapshot->chunks.size(); ++m_adoptedChunks)
+        for(const auto& movie : *snapshot->chunks[m_adoptedChunks])
+        {
+            m_movies.push_back({m_names.intern(movie.name),movie.year});
+            m_ratings.push_back(movie.rating);
+        }
+    const auto added{m_movies.size()-first};
+    if(added > 0)
+    {
+        m_ranking.append(static_cast<MovieId>(first),static_cast<MovieId>(m_movies.size()),ratingOf());
+        m_completions.insert(static_cast<MovieId>(first),static_cast<MovieId>(m_movies.size()),titleOf(),ratingOf());
+        m_years.insert(static_cast<MovieId>(first),static_cast<MovieId>(m_movies.size()),yearOf(),ratingOf());
+    }
+
+    if(snapshot->done)
+    {
+        static const auto loadedZone{Profiler::zone("startup.loaded")};
+        Profiler::record(loadedZone,m_started,Profiler::now());
+        m_loader.reset();
+    }
+    return added > 0;
+}
+
+void Movies::finishLoading()
+{
+    if(!m_loader)
+        return;
+    m_loader->wait();
+    adoptLoaded();
+}
+
+std::string Movies::loadingStatus() const
+{
+    if(!m_loader)
+        return "";
+    char status[64];
+    if(const auto rate{m_loader->rowsPerSecond()}; rate > 0)
+        std::snprintf(status,sizeof(status)," [ Loading catalog: %3.0f%%, %.0fk rows/s ]",m_loader->progress()*100,rate/1e3);
+    else
+        std::snprintf(status,sizeof(status)," [ Loading catalog: %3.0f%% ]",m_loader->progress()*100);
+    return status;
+}
 
-    moviefile.close();
-    std::sort(m_movies.begin(),m_movies.end(),[](const Movie& m1, const Movie& m2){ return m1.rating > m2.rating; });
+void Movies::drawLoadingStatus()
+{
+    std::string status{loadingStatus()};
+    status.resize(globalWidth/2,' ');
+    setText(stdscr,LINES-2,3,status.c_str());
+}
+
+// getch, except that it returns ERR every 100 ms while the catalog is still loading so views can pick up new rows.
+int Movies::waitKey()
+{
+    timeout(m_loader ? 100 : -1);
+    const auto c{Session::key()};
+    timeout(-1);
+    return c;
 }
 
 void Movies::loadHighscores()
 {
     auto highscoreFile{std::fstream(HighscoreFilename)};
+    Records::load<Score>(highscoreFile,[this](const Score& score){ m_scores.push_back(score); });
+    highscoreFile.close();
+}
+
+void Movies::loadComparisons()
+{
+    auto file{std::fstream(ComparisonsFilename)};
+    Records::load<Comparison>(file,[this](const Comparison& comparison){ m_comparisons.push_back(comparison); });
+}
+
+// Shows a notice and returns true when the session is an archive or a server client, whose catalog cannot be changed here.
+bool Movies::readOnly()
+{
+    if(!m_archive && !m_client)
+        return false;
+    auto w{ newwin(5,globalWidth,2,21) };
+    wattron(w,COLOR_PAIR(RED));
+    setText(w,2,2,m_archive ? "The archive catalog is read-only." : "Connected to a rating server: only rating, search and browse are available.");
+    box(w,0,0);
+    wrefresh(w);
+    Session::key();
+    delwin(w);
+    return true;
+}
+
+std::string Movies::remoteStatus()
+{
+    if(m_client)
+    {
+        const auto updates{m_client->updates()};
+        return updates ? std::to_string(m_client->size())+" movies on "+m_client->path()+", "+std::to_string(*updates)+" ratings from all clients"
+                       : "Connection to "+m_client->path()+" lost";
+    }
+    const auto& stats{m_archive->stats()};
+    return std::to_string(m_archive->size())+" movies in "+std::to_string(m_archive->shards())+" shards. Mapped "
+          +std::to_string(stats.mappedShards)+" ("+Utils::storage(stats.mappedBytes)+" of "+Utils::storage(m_archive->budget())+"), hits "
+          +std::to_string(stats.hits)+", misses "+std::to_string(stats.misses);
+}
+
+template<class Catalog>
+void Movies::remoteBrowse(Catalog& catalog)
+{
+    constexpr auto xStart{17+4};
+    auto w{ newwin(LINES-2,COLS-xStart-3,1,xStart+2) };
+    wattron(w,COLOR_PAIR(YELLOW));
+    const auto rows{LINES-4};
+    const auto last{std::max(0,static_cast<int>(catalog.size())-rows)};
+    int top{0};
+    int c{'\0'};
+    while(c!='q')
+    {
+        {
+        PROFILE_ZONE("browse.draw");
+        werase(w);
+        catalog.forEachInRange(top,rows,[&](std::size_t rank, const Movie& movie){
+            setText(w,1+rank-top,2,(std::to_string(rank+1)+"\t"+displayString(movie)).c_str());
+        });
+        }
+        box(w,0,0);
+        const auto title{remoteStatus()};
+        setText(w,0,2,title.c_str());
+        mvwchgat(w,0,2,title.size(),A_BOLD,COLOR_PAIR(YELLOW),nullptr);
+        wrefresh(w);
+        c = Session::key();
+        switch(c)
+        {
+            IfKeyDown:  { top++; break; }
+            IfKeyUp:    { top--; break; }
+            IfKeyRight: { top+=rows; break; }
+            IfKeyLeft:  { top-=rows; break; }
+        }
+        top = std::clamp(top,0,last);
+    }
+    delwin(w);
+}
+
+template<class Catalog>
+void Movies::remoteSearch(Catalog& catalog)
+{
+    auto w{ newwin(LINES-2,globalWidth,1,21) };
+    wattron(w,COLOR_PAIR(RED));
+    int c{'\0'};
     std::string str;
-    while(std::getline(highscoreFile,str))
+    while(c!='\n')
+    {
+        werase(w);
+        setText(w,1,2,"Search: ");
+        std::size_t found{0};
         if(!str.empty())
-            m_scores.push_back(deserialize<Score>(str));
-    highscoreFile.close();
+        {
+            PROFILE_ZONE("search.filter");
+            int y{5};
+            catalog.search(str,[&](std::size_t, const Movie& movie){
+                if(y<LINES-3)
+                    setText(w,y++,2,displayString(movie).c_str());
+                ++found;
+            });
+        }
+        setText(w,4,2,found ? ("Found "+std::to_string(found)+" movies:").c_str() : "No matches.");
+        setText(w,2,2,str.c_str());
+        mvwchgat(w,2,2,str.size(),A_BOLD,0,nullptr);
+        setText(w,3,2,remoteStatus().substr(0,globalWidth-4).c_str());
+        box(w,0,0);
+        wrefresh(w);
+        c=Session::key();
+        if(Utils::backspace(c))
+        {
+            if(!str.empty())
+                str.pop_back();
+        }
+        else if(Utils::validAscii(c))
+            str+=c;
+    }
+    delwin(w);
+}
+
+void Movies::archiveRecommend()
+{
+    constexpr auto Count{10};
+    std::vector<Recommender::Candidate> heap;
+    {
+    PROFILE_ZONE("recommend.archive");
+    const auto currentYear{Utils::currentYear()};
+    m_archive->forEachWhile([&](double ratingMax){ return heap.size() < Count || m_recommender.bound(ratingMax) > heap.front().score; },
+                            [&](std::size_t rank, const Movie& movie){
+        Recommender::offer(heap,Count,m_recommender.score(static_cast<MovieId>(rank),movie.rating,nullptr,movie.year,currentYear));
+    });
+    std::sort_heap(heap.begin(),heap.end(),Recommender::better);
+    }
+    auto w{ newwin(Count+2,globalWidth+10,2,21) };
+    wattron(w,COLOR_PAIR(MAGENTA));
+    int y{1};
+    for(const auto& candidate : heap)
+    {
+        m_archive->forEachInRange(candidate.id,1,[&](std::size_t, const Movie& movie){
+            setText(w,y,2,displayString(movie,(y < 10 ? " " : "")+std::to_string(y)+". ").c_str());
+        });
+        setText(w,y,globalWidth-6,("score "+std::to_string(candidate.score).substr(0,5)).c_str());
+        ++y;
+    }
+    box(w,0,0);
+    setText(w,0,2,"RECOMMENDATION");
+    wrefresh(w);
+    Session::key();
+    delwin(w);
 }
 
 std::string Movies::displayString(const Movie& movie, const std::string& preStr)
 {
+    ALLOCATION_SCOPE("displayString");
     std::stringstream ss;
     ss.precision(1);
     ss << std::fixed << preStr << movie.name << " ("<< movie.year << ") - " << movie.rating;
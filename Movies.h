@@ -1,102 +1,139 @@
 #include "Utils.h"
+#include "CatalogLoader.h"
+#include "Completions.h"
+#include "Ranking.h"
+#include "FlatMap.h"
+#include "Ratings.h"
+#include "Profiles.h"
+#include "Profiler.h"
+#include "RatingClient.h"
+#include "RatingHistory.h"
+#include "Recommender.h"
+#include "Records.h"
+#include "Screen.h"
+#include "ShardedCatalog.h"
+#include "TitlePool.h"
+#include "YearIndex.h"
 #include "ncurses.h"
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <sstream>
-#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
 
 class Movies{
 public:
-    struct Movie
-    {
-        double rating{};
-        std::string name;
-        int year{};
-    };
+    using Movie = Records::Movie;
     Movies();
+    // Read-only session over a sharded archive catalog that keeps at most budgetBytes of it mapped.
+    Movies(const std::filesystem::path& archive, std::size_t budgetBytes);
+    // Rates, searches and browses the shared catalog of a rating server.
+    explicit Movies(std::unique_ptr<RatingClient> client);
     ~Movies();
     int execute();
 private:
-    struct Score
+    using Score = Records::Score;
+    using Comparison = Records::Comparison;
+
+    struct Title
+    {
+        TitlePool::Handle name{};
+        int year{};
+    };
+
+    struct Snapshot
     {
-        int score{};
-        std::string timestamp;
+        std::string name;
+        Ratings ratings;
     };
 
     struct MenuItem{
         std::string text;
         std::function<int()> fcn;
     };
-    void loadMovies();
+    Movies(std::unique_ptr<ShardedCatalog> archive, std::unique_ptr<RatingClient> client);
     void loadHighscores();
+    void loadComparisons();
+    bool adoptLoaded();
+    void finishLoading();
+    std::string loadingStatus() const;
+    void drawLoadingStatus();
+    int waitKey();
+
+    bool readOnly();
+    std::string remoteStatus();
+    template<class Catalog>
+    void remoteBrowse(Catalog& catalog);
+    template<class Catalog>
+    void remoteSearch(Catalog& catalog);
+    void remoteRate();
+    void archiveRecommend();
     void createMenu();
     void initColors();
 
     void addMovie();
     void rateMovies();
     void browse();
+    std::optional<YearIndex::Filter> editFilter();
     void recommend();
     void search();
     void snake();
     void gameOfLife();
     void graph();
+    void ratingHistory(WINDOW* w, int height, int width);
     void list();
     void reset();
+    void profiler();
+    void profiles();
     void shutdown();
 
-    Movie highestRatedMovie();
+    void takeSnapshot(const std::string& name);
+    std::vector<MovieId> switchRatings(const Ratings& ratings);
+    void showRestored(WINDOW* w, const std::vector<MovieId>& restored);
+    std::size_t switchProfile(const std::string& name);
+    void recordRating(MovieId id, double previous);
 
+    void drawProfiler(Screen& screen, int y, int x);
+    void memory();
+    void drawAllocations(WINDOW* w, int y, int x, int lastLine);
     std::string displayString(const Movie& movie, const std::string& preStr = "");
     std::string getStrInput(WINDOW* win, int y, int x, int color = 0, bool bold = true);
-    std::pair<Movie,double> highestDiffMovie();
+    auto ratingOf() const { return [this](MovieId id){ return m_ratings[id]; }; }
+    std::string_view name(MovieId id) const { return m_names[m_movies[id].name]; }
+    auto titleOf() const { return [this](MovieId id){ return name(id); }; }
+    auto yearOf() const { return [this](MovieId id){ return m_movies[id].year; }; }
+    Movie movie(MovieId id) const { return {m_ratings[id], std::string{name(id)}, m_movies[id].year}; }
+
+    const std::uint64_t m_started{Profiler::now()};
+    std::unique_ptr<ShardedCatalog> m_archive;
+    std::unique_ptr<RatingClient> m_client;
+    std::unique_ptr<CatalogLoader> m_loader;
+    std::size_t m_adoptedChunks{0};
+    std::chrono::steady_clock::time_point m_lastAdopted{};
+    bool m_interactive{false};
+    // How Snake, Game of Life, Graph and Matrix draw; V in the menu switches it.
+    Screen::Renderer m_renderer{Screen::Renderer::Curses};
 
-    std::vector<Movie> m_movies;
+    TitlePool m_names;
+    std::vector<Title> m_movies;
+    Ratings m_ratings;
     std::vector<Score> m_scores;
+    std::vector<Comparison> m_comparisons;
+    Ranking m_ranking;
+    Completions m_completions;
+    YearIndex m_years;
+    RatingHistory m_history;
 
-    std::unordered_map<int,double> m_ratedMovies;
-    std::unordered_map<std::string,int> m_ratingCache;
+    FlatMap<MovieId,double> m_ratedMovies;
+    // Bumped on every change to m_ratedMovies, which the ratings stamp does not cover.
+    std::uint64_t m_ratedGeneration{0};
+    std::vector<Snapshot> m_snapshots;
+    Profiles m_profiles{"profiles"};
+    Recommender m_recommender;
 
     const std::vector<std::vector<MenuItem>> m_menuItems;
     const std::vector<std::string> m_titles;
     
     int m_exitCode{0};
-
-    template<class T>
-    void serializeToFile(const std::string& fileName, const std::vector<T>& data)
-    {
-        auto file{std::fstream{fileName,std::ios_base::app}};
-        for(const auto& object : data)
-            file << serialize(object);
-        file.close();
-    }
-
-    template<class T>
-    std::string serialize(const T& object)
-    {
-        std::stringstream ss;
-        if constexpr (std::is_same<T,Score>())
-        {
-            ss << object.score << ","
-               << object.timestamp << std::endl;
-        }
-        else if constexpr (std::is_same<T,Movie>())
-        {
-            ss << object.rating<< ","
-               << object.name  << ","
-               << object.year  << std::endl; 
-        }
-        return ss.str();
-    }
-
-    template<class T>
-    T deserialize(const std::string& str) 
-    {
-        const auto tokens{Utils::tokenize(str)};
-        if constexpr (std::is_same<T,Score>())
-            return { std::atoi(tokens[0].c_str()),tokens[1]};
-        
-        if constexpr (std::is_same<T,Movie>())
-            return{ std::atof(tokens[0].c_str()), tokens[1], std::atoi(tokens[2].c_str())};
-    }
 };
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "Plot.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+    // Braille dot bits by [dot row][dot column] within a cell (Unicode block U+2800).
+    constexpr std::uint8_t Dots[4][2]{{0x01,0x08},{0x02,0x10},{0x04,0x20},{0x40,0x80}};
+    constexpr std::uint8_t UpperDots{0x01|0x08|0x02|0x10};
+}
+
+void Plot::Series::append(double x, double y)
+{
+    m_points.push_back({x,y});
+    if(m_points.size()%Block)
+        return;
+    // The newest block just completed; fold it into level 0, then pair up complete blocks level by level.
+    auto extent{std::pair{y,y}};
+    for(auto point{m_points.end()-Block}; point!=m_points.end(); ++point)
+        extent = {std::min(extent.first,point->y),std::max(extent.second,point->y)};
+    for(std::size_t level=0;; ++level)
+    {
+        if(level == m_levels.size())
+            m_levels.emplace_back();
+        auto& blocks{m_levels[level]};
+        blocks.push_back(extent);
+        if(blocks.size()%2)
+            return;
+        const auto& left{blocks[blocks.size()-2]};
+        extent = {std::min(left.first,extent.first),std::max(left.second,extent.second)};
+    }
+}
+
+void Plot::Series::clear()
+{
+    ++m_generation;
+    m_points.clear();
+    m_levels.clear();
+}
+
+std::size_t Plot::Series::lowerBound(double x) const
+{
+    return std::partition_point(m_points.begin(),m_points.end(),[x](const Point& point){ return point.x < x; })-m_points.begin();
+}
+
+std::pair<double,double> Plot::Series::extent(std::size_t first, std::size_t last) const
+{
+    auto extent{std::pair{m_points[first].y,m_points[first].y}};
+    const auto take{[&extent](double low, double high){ extent = {std::min(extent.first,low),std::max(extent.second,high)}; }};
+    auto i{first};
+    for(; i<last && i%Block; ++i)
+        take(m_points[i].y,m_points[i].y);
+    // Largest aligned complete block that fits, each step; complete blocks always have a summary.
+    while(i+Block <= last)
+    {
+        std::size_t level{0};
+        while(level+1 < m_levels.size() && i%(Block << (level+1)) == 0 && i+(Block << (level+1)) <= last)
+            ++level;
+        const auto& block{m_levels[level][i/(Block << level)]};
+        take(block.first,block.second);
+        i += Block << level;
+    }
+    for(; i<last; ++i)
+        take(m_points[i].y,m_points[i].y);
+    return extent;
+}
+
+void Plot::Canvas::resize(int columns, int rows)
+{
+    m_columns = std::max(columns,0);
+    m_rows = std::max(rows,0);
+    m_cells.resize(static_cast<std::size_t>(m_columns)*m_rows);
+}
+
+void Plot::Canvas::clear()
+{
+    std::fill(m_cells.begin(),m_cells.end(),0);
+}
+
+void Plot::Canvas::set(int x, int y)
+{
+    if(x < 0 || y < 0 || x >= width() || y >= height())
+        return;
+    m_cells[static_cast<std::size_t>(y/4)*m_columns+x/2] |= Dots[y%4][x%2];
+}
+
+void Plot::Canvas::line(int x0, int y0, int x1, int y1)
+{
+    const auto dx{std::abs(x1-x0)};
+    const auto dy{-std::abs(y1-y0)};
+    const auto stepX{x0 < x1 ? 1 : -1};
+    const auto stepY{y0 < y1 ? 1 : -1};
+    auto error{dx+dy};
+    for(;;)
+    {
+        set(x0,y0);
+        if(x0 == x1 && y0 == y1)
+            return;
+        const auto twice{2*error};
+        if(twice >= dy)
+        {
+            error += dy;
+            x0 += stepX;
+        }
+        if(twice <= dx)
+        {
+            error += dx;
+            y0 += stepY;
+        }
+    }
+}
+
+const std::string& Plot::Canvas::row(int row, bool unicode)
+{
+    m_row.clear();
+    const auto cells{m_cells.data()+static_cast<std::size_t>(row)*m_columns};
+    for(int column=0; column<m_columns; ++column)
+    {
+        const auto dots{cells[column]};
+        if(!dots)
+            m_row += ' ';
+        else if(unicode)
+        {
+            m_row += static_cast<char>(0xe2);
+            m_row += static_cast<char>(0xa0 | dots >> 6);
+            m_row += static_cast<char>(0x80 | (dots & 0x3f));
+        }
+        else
+            m_row += (dots & UpperDots) ? ((dots & ~UpperDots) ? ':' : '\'') : '.';
+    }
+    return m_row;
+}
+
+void Plot::lttb(const Point* points, std::size_t count, std::size_t threshold, std::vector<Point>& out)
+{
+    out.clear();
+    if(threshold >= count || threshold < 3)
+    {
+        out.assign(points,points+count);
+        return;
+    }
+    // Bucket i keeps the point forming the largest triangle with the last kept point and the mean of bucket i+1.
+    const auto every{static_cast<double>(count-2)/(threshold-2)};
+    std::size_t kept{0};
+    out.push_back(points[0]);
+    for(std::size_t i=0; i<threshold-2; ++i)
+    {
+        const auto nextFirst{static_cast<std::size_t>((i+1)*every)+1};
+        const auto nextLast{std::min(static_cast<std::size_t>((i+2)*every)+1,count)};
+        double meanX{0};
+        double meanY{0};
+        for(auto j{nextFirst}; j<nextLast; ++j)
+        {
+            meanX += points[j].x;
+            meanY += points[j].y;
+        }
+        meanX /= nextLast-nextFirst;
+        meanY /= nextLast-nextFirst;
+        const auto& a{points[kept]};
+        auto largest{-1.0};
+        auto chosen{nextFirst-1};
+        for(auto j{static_cast<std::size_t>(i*every)+1}; j<nextFirst; ++j)
+        {
+            const auto area{std::abs((a.x-meanX)*(points[j].y-a.y)-(a.x-points[j].x)*(meanY-a.y))};
+            if(area > largest)
+            {
+                largest = area;
+                chosen = j;
+            }
+        }
+        out.push_back(points[chosen]);
+        kept = chosen;
+    }
+    out.push_back(points[count-1]);
+}
+
+void Plot::Plotter::draw(const Series& series, Method method, Canvas& canvas, double from, double to, double low, double high)
+{
+    PROFILE_ZONE("plot.draw");
+    m_drawn = 0;
+    const auto width{canvas.width()};
+    const auto height{canvas.height()};
+    const auto& points{series.points()};
+    const auto first{series.lowerBound(from)};
+    const auto last{static_cast<std::size_t>(std::partition_point(points.begin()+first,points.end(),[to](const Point& point){ return point.x <= to; })-points.begin())};
+    if(first >= last || width < 1 || height < 1)
+        return;
+    const auto scaleX{to > from ? (width-1)/(to-from) : 0.0};
+    const auto scaleY{high > low ? (height-1)/(high-low) : 0.0};
+    const auto dotX{[&](double x){ return static_cast<int>(std::lround((x-from)*scaleX)); }};
+    const auto dotY{[&](double y){ return high > low ? height-1-static_cast<int>(std::lround((y-low)*scaleY)) : height/2; }};
+
+    if(method == Method::MinMax && scaleX > 0)
+    {
+        // Each dot column spans its points' y extent and joins the previous column's last point to its first.
+        auto start{first};
+        std::size_t previous{last};
+        for(int column=0; column<width && start<last; ++column)
+        {
+            const auto end{std::max(start,std::min(last,series.lowerBound(from+(column+0.5)/scaleX)))};
+            if(start == end)
+                continue;
+            const auto [lowest,highest]{series.extent(start,end)};
+            canvas.line(column,dotY(lowest),column,dotY(highest));
+            if(previous != last)
+                canvas.line(dotX(points[previous].x),dotY(points[previous].y),column,dotY(points[start].y));
+            m_drawn += std::min<std::size_t>(end-start,2);
+            previous = end-1;
+            start = end;
+        }
+        return;
+    }
+    if(const Key key{&series,series.generation(),first,last,width}; key != m_sampledKey)
+    {
+        lttb(points.data()+first,last-first,static_cast<std::size_t>(width),m_sampled);
+        m_sampledKey = key;
+    }
+    m_drawn = m_sampled.size();
+    auto previous{m_sampled.front()};
+    for(const auto& point : m_sampled)
+    {
+        canvas.line(dotX(previous.x),dotY(previous.y),dotX(point.x),dotY(point.y));
+        previous = point;
+    }
+}
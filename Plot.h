@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+Line plots at terminal resolution. A Series is an append-only run of
+points with non-decreasing x; alongside the points it keeps the lowest
+and highest y of every aligned block of 64 << k points, extended as
+points arrive, so the y extent of any index range costs a few block
+lookups instead of a scan. Drawing reduces the visible points to the
+canvas width first, either keeping each dot column's extremes (min-max,
+exact for spikes, via the blocks) or with Largest-Triangle-Three-Buckets
+(Steinarsson, 2013), which keeps the visual shape of the whole line and
+is reused until the series grows or the view changes. The Canvas
+rasterises into Braille cells of 2x4 dots in storage that is reused
+from frame to frame.
+*/
+namespace Plot
+{
+    struct Point
+    {
+        double x{};
+        double y{};
+    };
+
+    class Series
+    {
+    public:
+        void append(double x, double y);
+        void clear();
+
+        bool empty() const { return m_points.empty(); }
+        std::size_t size() const { return m_points.size(); }
+        const Point& operator[](std::size_t index) const { return m_points[index]; }
+        const Point& front() const { return m_points.front(); }
+        const Point& back() const { return m_points.back(); }
+        const std::vector<Point>& points() const { return m_points; }
+        // Changes whenever points are removed, so equal generation and size mean equal points.
+        std::uint64_t generation() const { return m_generation; }
+
+        // Index of the first point with x >= value.
+        std::size_t lowerBound(double x) const;
+        // Lowest and highest y of the points in [first, last); first < last.
+        std::pair<double,double> extent(std::size_t first, std::size_t last) const;
+
+    private:
+        static constexpr std::size_t Block{64};
+
+        std::vector<Point> m_points;
+        std::uint64_t m_generation{0};
+        // Level k holds the y extent of each complete block of Block << k points.
+        std::vector<std::vector<std::pair<double,double>>> m_levels;
+    };
+
+    class Canvas
+    {
+    public:
+        // Cells of the canvas; the dots are twice as wide and four times as high.
+        void resize(int columns, int rows);
+        void clear();
+        int columns() const { return m_columns; }
+        int rows() const { return m_rows; }
+        int width() const { return m_columns*2; }
+        int height() const { return m_rows*4; }
+
+        // Dot (x, y) with y = 0 at the top; dots outside the canvas are ignored.
+        void set(int x, int y);
+        void line(int x0, int y0, int x1, int y1);
+
+        // One row of cells as UTF-8 Braille, or as ' . : characters when unicode is false. Valid until the next call.
+        const std::string& row(int row, bool unicode);
+
+    private:
+        std::vector<std::uint8_t> m_cells;
+        std::string m_row;
+        int m_columns{0};
+        int m_rows{0};
+    };
+
+    enum class Method{ MinMax, Lttb };
+
+    // Reduces points to at most threshold points, always keeping the first and last.
+    void lttb(const Point* points, std::size_t count, std::size_t threshold, std::vector<Point>& out);
+
+    // Draws the points of series with from <= x <= to, scaled so [low, high] spans the canvas height.
+    // The LTTB reduction is kept and reused while the series, visible range and width are unchanged.
+    class Plotter
+    {
+    public:
+        void draw(const Series& series, Method method, Canvas& canvas, double from, double to, double low, double high);
+        // Points drawn by the last call after downsampling.
+        std::size_t drawn() const { return m_drawn; }
+    private:
+        struct Key
+        {
+            const Series* series{};
+            std::uint64_t generation{};
+            std::size_t first{};
+            std::size_t last{};
+            int width{};
+            bool operator==(const Key&) const = default;
+        };
+
+        std::vector<Point> m_sampled;
+        Key m_sampledKey;
+        std::size_t m_drawn{0};
+    };
+}
@@ -0,0 +1,209 @@
+#include "Profiler.h"
+#include "Utils.h"
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    constexpr auto TraceEvents{1u << 16};
+
+    struct TraceEvent
+    {
+        std::uint64_t startNs{};
+        std::uint64_t durationNs{};
+        std::uint32_t thread{};
+        Profiler::ZoneId zone{};
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Profiler::ThreadBuffer>> buffers;
+        std::uint32_t threads{0};
+        std::array<Profiler::ZoneStats,Profiler::MaxZones> zones;
+        std::atomic<std::size_t> zoneCount{0};
+        Utils::Queue<TraceEvent> trace{TraceEvents};
+        const std::uint64_t originTicks{Profiler::now()};
+        const std::chrono::steady_clock::time_point originTime{std::chrono::steady_clock::now()};
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    // Nanoseconds per tick, measured over the lifetime of the process so far
+    double nsPerTick()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        auto& reg{registry()};
+        const auto ticks{Profiler::now()-reg.originTicks};
+        const std::chrono::duration<double,std::nano> elapsed{std::chrono::steady_clock::now()-reg.originTime};
+        return ticks ? elapsed.count()/ticks : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+}
+
+Profiler::ZoneId Profiler::zone(const char* name)
+{
+    auto& reg{registry()};
+    const std::lock_guard lock{reg.mutex};
+    const auto count{reg.zoneCount.load(std::memory_order_relaxed)};
+    for(std::size_t i=0; i<count; ++i)
+        if(reg.zones[i].name == name)
+            return static_cast<ZoneId>(i);
+    if(count == MaxZones)
+        return MaxZones-1;
+    // Filled in before it is counted, so stats() never sees a zone without its name.
+    reg.zones[count].name = count == MaxZones-1 ? "(other)" : name;
+    reg.zoneCount.store(count+1,std::memory_order_release);
+    return static_cast<ZoneId>(count);
+}
+
+Profiler::ThreadBuffer& Profiler::registerThread()
+{
+    auto& reg{registry()};
+    const std::lock_guard lock{reg.mutex};
+    // A buffer whose thread has exited and whose samples collect() has taken is reused, so threads
+    // that come and go, such as server connections, do not add a ring each.
+    auto found{std::find_if(reg.buffers.begin(),reg.buffers.end(),[](const auto& buffer){
+        return buffer->retired.load(std::memory_order_acquire) && buffer->tail.load(std::memory_order_relaxed) == buffer->head.load(std::memory_order_relaxed);
+    })};
+    if(found == reg.buffers.end())
+        found = reg.buffers.insert(reg.buffers.end(),std::make_unique<ThreadBuffer>());
+    auto& buffer{**found};
+    buffer.retired.store(false,std::memory_order_relaxed);
+    buffer.thread = ++reg.threads;
+    return buffer;
+}
+
+void Profiler::collect()
+{
+    auto& reg{registry()};
+    const std::lock_guard lock{reg.mutex};
+    const auto scale{nsPerTick()};
+    for(const auto& buffer : reg.buffers)
+    {
+        const auto tail{buffer->tail.load(std::memory_order_relaxed)};
+        const auto head{buffer->head.load(std::memory_order_acquire)};
+        for(auto i{tail}; i<head; ++i)
+        {
+            const auto& sample{buffer->samples[i%ThreadBuffer::Size]};
+            const auto durationNs{static_cast<std::uint64_t>((sample.end-sample.start)*scale)};
+            auto& stats{reg.zones[sample.zone]};
+            stats.histogram.add(durationNs);
+            stats.lastNs = durationNs;
+            reg.trace.add({static_cast<std::uint64_t>((sample.start-reg.originTicks)*scale),durationNs,buffer->thread,sample.zone});
+        }
+        buffer->tail.store(head,std::memory_order_release);
+    }
+}
+
+std::span<const Profiler::ZoneStats> Profiler::stats()
+{
+    auto& reg{registry()};
+    return {reg.zones.data(),reg.zoneCount.load(std::memory_order_acquire)};
+}
+
+std::uint64_t Profiler::dropped()
+{
+    auto& reg{registry()};
+    const std::lock_guard lock{reg.mutex};
+    std::uint64_t total{0};
+    for(const auto& buffer : reg.buffers)
+        total += buffer->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+void Profiler::reset()
+{
+    auto& reg{registry()};
+    const std::lock_guard lock{reg.mutex};
+    for(std::size_t i=0; i<reg.zoneCount.load(std::memory_order_relaxed); ++i)
+        reg.zones[i] = {reg.zones[i].name};
+    reg.trace = Utils::Queue<TraceEvent>{TraceEvents};
+}
+
+bool Profiler::exportTrace(const std::string& fileName)
+{
+    auto& reg{registry()};
+    const std::lock_guard lock{reg.mutex};
+    auto file{std::fstream{fileName,std::ios_base::out | std::ios_base::trunc}};
+    if(!file)
+        return false;
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    auto first{true};
+    for(const auto& event : reg.trace)
+    {
+        file << (first ? "" : ",")
+             << "{\"name\":\"" << reg.zones[event.zone].name << "\",\"ph\":\"X\",\"pid\":1"
+             << ",\"tid\":" << event.thread
+             << ",\"ts\":" << event.startNs/1000.0
+             << ",\"dur\":" << event.durationNs/1000.0 << "}";
+        first = false;
+    }
+    file << "],\"displayTimeUnit\":\"ns\"}\n";
+    file.close();
+    return true;
+}
+
+void Profiler::Histogram::add(std::uint64_t ns)
+{
+    if(m_buckets.empty())
+        m_buckets.resize(bucket(UINT64_MAX)+1);
+    ++m_buckets[bucket(ns)];
+    ++m_count;
+    m_sum += ns;
+    m_max = std::max(m_max,ns);
+}
+
+void Profiler::Histogram::merge(const Histogram& other)
+{
+    if(other.m_buckets.empty())
+        return;
+    if(m_buckets.empty())
+        m_buckets.resize(other.m_buckets.size());
+    for(std::size_t i=0; i<m_buckets.size(); ++i)
+        m_buckets[i] += other.m_buckets[i];
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = std::max(m_max,other.m_max);
+}
+
+std::uint64_t Profiler::Histogram::percentile(double q) const
+{
+    const auto target{static_cast<std::uint64_t>(q*m_count)};
+    std::uint64_t seen{0};
+    for(std::size_t i=0; i<m_buckets.size(); ++i)
+    {
+        seen += m_buckets[i];
+        if(seen > target)
+            return std::min(lowerBound(i),m_max);
+    }
+    return m_max;
+}
+
+std::size_t Profiler::Histogram::bucket(std::uint64_t ns)
+{
+    if(ns < Linear)
+        return ns;
+    const std::size_t power(std::bit_width(ns)-1);
+    const auto sub{(ns >> (power-5)) & (SubBuckets-1)};
+    return Linear+(power-6)*SubBuckets+sub;
+}
+
+std::uint64_t Profiler::Histogram::lowerBound(std::size_t bucket)
+{
+    if(bucket < Linear)
+        return bucket;
+    const auto power{(bucket-Linear)/SubBuckets+6};
+    const auto sub{(bucket-Linear)%SubBuckets};
+    return (std::uint64_t{1} << power) | (sub << (power-5));
+}
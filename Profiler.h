@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+Hot-path instrumentation. A scoped zone costs two timestamp reads and one
+store into a ring buffer owned by the calling thread; nothing is locked
+or allocated. The UI thread periodically collects every ring into
+per-zone histograms and a bounded trace that can be exported for
+chrome://tracing.
+*/
+namespace Profiler
+{
+    using ZoneId = std::uint16_t;
+    constexpr std::size_t MaxZones{256};
+
+    struct Sample
+    {
+        std::uint64_t start;
+        std::uint64_t end;
+        ZoneId zone;
+    };
+
+    // Single-producer ring filled by its thread and emptied by collect(). Once its thread has exited and
+    // collect() has emptied it, the next thread to register takes it over.
+    struct ThreadBuffer
+    {
+        static constexpr std::size_t Size{4096};
+        std::array<Sample,Size> samples;
+        alignas(64) std::atomic<std::uint64_t> head{0};
+        alignas(64) std::atomic<std::uint64_t> tail{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::atomic<bool> retired{false};
+        std::uint32_t thread{0};
+    };
+
+    // Log-linear histogram: exact below 64 ns, then 32 buckets per power of two (about 3% resolution).
+    class Histogram
+    {
+    public:
+        void add(std::uint64_t ns);
+        void merge(const Histogram& other);
+        std::uint64_t percentile(double q) const;
+        std::uint64_t count() const { return m_count; }
+        std::uint64_t max() const { return m_max; }
+        double mean() const { return m_count ? static_cast<double>(m_sum)/m_count : 0.0; }
+    private:
+        static constexpr std::size_t Linear{64};
+        static constexpr std::size_t SubBuckets{32};
+        static std::size_t bucket(std::uint64_t ns);
+        static std::uint64_t lowerBound(std::size_t bucket);
+
+        std::vector<std::uint64_t> m_buckets;
+        std::uint64_t m_count{0};
+        std::uint64_t m_sum{0};
+        std::uint64_t m_max{0};
+    };
+
+    struct ZoneStats
+    {
+        std::string name;
+        Histogram histogram;
+        std::uint64_t lastNs{0};
+    };
+
+    // The zone registered under name, registering it first if needed; past MaxZones names share an "(other)" zone.
+    ZoneId zone(const char* name);
+    ThreadBuffer& registerThread();
+
+    // Holds the calling thread's buffer and retires it when the thread exits.
+    class ThreadOwner
+    {
+        ThreadBuffer& m_buffer;
+    public:
+        ThreadOwner() : m_buffer{registerThread()} {}
+        ~ThreadOwner() { m_buffer.retired.store(true,std::memory_order_release); }
+        ThreadOwner(const ThreadOwner&) = delete;
+        ThreadOwner& operator=(const ThreadOwner&) = delete;
+        ThreadBuffer& buffer() const { return m_buffer; }
+    };
+
+    inline std::uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    inline void record(ZoneId zone, std::uint64_t start, std::uint64_t end)
+    {
+        thread_local const ThreadOwner owner;
+        auto& buffer{owner.buffer()};
+        const auto head{buffer.head.load(std::memory_order_relaxed)};
+        if(head-buffer.tail.load(std::memory_order_acquire) == ThreadBuffer::Size)
+        {
+            buffer.dropped.fetch_add(1,std::memory_order_relaxed);
+            return;
+        }
+        buffer.samples[head%ThreadBuffer::Size] = {start,end,zone};
+        buffer.head.store(head+1,std::memory_order_release);
+    }
+
+    class Scope
+    {
+        ZoneId m_zone;
+        std::uint64_t m_start;
+    public:
+        explicit Scope(ZoneId zone) : m_zone{zone}, m_start{now()} {}
+        ~Scope() { record(m_zone,m_start,now()); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Drains every thread's ring; call from one thread only.
+    void collect();
+    // Zones registered so far. The table never moves, so this is safe while other threads register zones.
+    std::span<const ZoneStats> stats();
+    std::uint64_t dropped();
+    void reset();
+    bool exportTrace(const std::string& fileName);
+}
+
+#define PROFILE_CONCAT_IMPL(a,b) a##b
+#define PROFILE_CONCAT(a,b) PROFILE_CONCAT_IMPL(a,b)
+#define PROFILE_ZONE(name) \
+    static const auto PROFILE_CONCAT(profileZone,__LINE__){Profiler::zone(name)}; \
+    const Profiler::Scope PROFILE_CONCAT(profileScope,__LINE__){PROFILE_CONCAT(profileZone,__LINE__)}
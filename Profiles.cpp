@@ -0,0 +1,75 @@
+#include "Profiles.h"
+#include "FileWriter.h"
+#include <charconv>
+#include <fstream>
+
+Profiles::Profiles(std::filesystem::path directory) :
+    m_directory{std::move(directory)}
+{
+    m_profiles[Default];
+    std::error_code error;
+    for(const auto& entry : std::filesystem::directory_iterator{m_directory,error})
+        if(entry.is_regular_file() && entry.path().extension() == Extension)
+            m_profiles[entry.path().stem().string()];
+}
+
+std::vector<std::string> Profiles::names() const
+{
+    std::vector<std::string> names{Default};
+    for(const auto& [name,ratings] : m_profiles)
+        if(name != Default)
+            names.push_back(name);
+    return names;
+}
+
+const Ratings& Profiles::load(const std::string& name, std::size_t size)
+{
+    auto& ratings{m_profiles[name]};
+    if(!ratings)
+    {
+        ratings.emplace();
+        auto file{std::fstream{path(name)}};
+        std::string str;
+        while(ratings->size() < size && std::getline(file,str))
+            ratings->push_back(std::atof(str.c_str()));
+        file.close();
+    }
+    while(ratings->size() < size)
+        ratings->push_back(DefaultRating);
+    return *ratings;
+}
+
+void Profiles::store(const std::string& name, const Ratings& ratings)
+{
+    m_profiles[name] = ratings;
+}
+
+bool Profiles::save() const
+{
+    auto saved{true};
+    for(const auto& [name,ratings] : m_profiles)
+    {
+        // the default profile is saved with the catalog
+        if(name == Default || !ratings)
+            continue;
+        std::error_code error;
+        std::filesystem::create_directories(m_directory,error);
+        if(error)
+            return false;
+        FileWriter writer{path(name).string()};
+        char digits[32];
+        for(std::size_t id=0; id<ratings->size(); ++id)
+        {
+            auto end{std::to_chars(digits,digits+sizeof(digits),(*ratings)[id]).ptr};
+            *end++ = '\n';
+            writer.append({digits,static_cast<std::size_t>(end-digits)});
+        }
+        saved = writer.commit() && saved;
+    }
+    return saved;
+}
+
+std::filesystem::path Profiles::path(const std::string& name) const
+{
+    return m_directory / (name+Extension);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Ratings.h"
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+Named rating columns over the shared catalog. Profiles found on disk are
+only listed at startup and read the first time they are used; branching
+shares every page with its parent until one of them writes.
+*/
+class Profiles
+{
+public:
+    static constexpr auto Default{"default"};
+
+    explicit Profiles(std::filesystem::path directory);
+
+    std::vector<std::string> names() const;
+    const std::string& active() const { return m_active; }
+    void setActive(const std::string& name) { m_active = name; }
+    bool contains(const std::string& name) const { return m_profiles.contains(name); }
+
+    // Column for a profile, read from disk on first use and padded with DefaultRating up to size.
+    const Ratings& load(const std::string& name, std::size_t size);
+    void store(const std::string& name, const Ratings& ratings);
+    // Writes every loaded profile but the default; false if the directory or any file could not be written.
+    bool save() const;
+
+private:
+    static constexpr auto DefaultRating{1000.0};
+    static constexpr auto Extension{".txt"};
+
+    std::filesystem::path m_directory;
+    std::map<std::string,std::optional<Ratings>> m_profiles;
+    std::string m_active{Default};
+
+    std::filesystem::path path(const std::string& name) const;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Records.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+Wire format between the rating server and its clients. Every message is
+a frame: a 32-bit little-endian payload length followed by the payload.
+A request payload starts with an Op byte, a response payload with a
+Status byte; the arguments and results that follow are fixed-width
+little-endian numbers and binary Records::Movie values.
+
+  Info                              -> u32 movies, u64 updates
+  Pair                              -> 2 x (u32 id, Movie)
+  Rate    u32 first, u32 second, u8 firstWins -> f64 first, f64 second
+  Search  u32 limit, query bytes    -> u32 rows, rows x (u32 rank, Movie), best ranked first
+  Range   u32 first, u32 count      -> u32 rows, rows x (u32 rank, Movie)
+*/
+namespace Protocol
+{
+    enum class Op : std::uint8_t { Info = 1, Pair, Rate, Search, Range };
+    enum class Status : std::uint8_t { Ok = 0, Error };
+
+    constexpr std::uint32_t MaxFrame{16 << 20};
+    // Rows in one Search or Range response.
+    constexpr std::uint32_t MaxRows{1000};
+
+    // Builds one frame; the length prefix is filled in by frame().
+    class Writer
+    {
+        std::string m_data;
+    public:
+        Writer() { clear(); }
+        void clear() { m_data.assign(sizeof(std::uint32_t),'\0'); }
+
+        template<class T>
+        Writer& put(T value)
+        {
+            static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+            const auto size{m_data.size()};
+            m_data.resize(size+sizeof(T));
+            std::memcpy(m_data.data()+size,&value,sizeof(T));
+            return *this;
+        }
+        Writer& put(std::string_view bytes) { m_data += bytes; return *this; }
+        Writer& put(const Records::Movie& movie) { Records::encodeBinary(movie,m_data); return *this; }
+
+        // Offset of the next value, to patch() a count that is only known after its rows.
+        std::size_t offset() const { return m_data.size(); }
+        template<class T>
+        void patch(std::size_t offset, T value) { std::memcpy(m_data.data()+offset,&value,sizeof(T)); }
+
+        const std::string& frame()
+        {
+            const auto length{static_cast<std::uint32_t>(m_data.size()-sizeof(std::uint32_t))};
+            std::memcpy(m_data.data(),&length,sizeof(length));
+            return m_data;
+        }
+    };
+
+    // Reads one payload front to back; a read past the end leaves ok() false.
+    class Reader
+    {
+        std::string_view m_data;
+        bool m_ok{true};
+    public:
+        explicit Reader(std::string_view data) : m_data{data} {}
+        bool ok() const { return m_ok; }
+
+        template<class T>
+        T get()
+        {
+            T value{};
+            if(m_data.size() < sizeof(T))
+            {
+                m_ok = false;
+                return value;
+            }
+            std::memcpy(&value,m_data.data(),sizeof(T));
+            m_data.remove_prefix(sizeof(T));
+            return value;
+        }
+        bool get(Records::Movie& movie) { return m_ok = m_ok && Records::decodeBinary(m_data,movie); }
+        std::string_view rest() { const auto rest{m_data}; m_data = {}; return rest; }
+    };
+
+    inline bool sendAll(int fd, const char* data, std::size_t size)
+    {
+        while(size > 0)
+        {
+            const auto sent{::send(fd,data,size,MSG_NOSIGNAL)};
+            if(sent < 0 && errno == EINTR)
+                continue;
+            if(sent <= 0)
+                return false;
+            data += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+        return true;
+    }
+
+    inline bool receiveAll(int fd, char* data, std::size_t size)
+    {
+        while(size > 0)
+        {
+            const auto received{::recv(fd,data,size,0)};
+            if(received < 0 && errno == EINTR)
+                continue;
+            if(received <= 0)
+                return false;
+            data += received;
+            size -= static_cast<std::size_t>(received);
+        }
+        return true;
+    }
+
+    inline bool send(int fd, Writer& writer)
+    {
+        const auto& frame{writer.frame()};
+        return sendAll(fd,frame.data(),frame.size());
+    }
+
+    // Reads the next frame's payload into payload, reusing its storage.
+    inline bool receive(int fd, std::string& payload)
+    {
+        std::uint32_t length;
+        if(!receiveAll(fd,reinterpret_cast<char*>(&length),sizeof(length)) || length > MaxFrame)
+            return false;
+        payload.resize(length);
+        return receiveAll(fd,payload.data(),length);
+    }
+}
@@ -3,6 +3,7 @@ Contains a string of random characters,
 corresponding to a single column being displayed onscreen.
 */
 #include "Raindrop.h"
+#include "Screen.h"
 #include "Utils.h"
 #include <ncurses.h>
 #include <random>
@@ -16,13 +17,13 @@ Raindrop::Raindrop(int xPos, bool startAsBlank) :
     str.resize(LINES,' ');
 }
 
-void Raindrop::update(){
+void Raindrop::update(Screen& screen){
     for(int c = 0; c < str.size(); c++)
     {   
-        if(c<str.size()-1 && static_cast<char>(mvinch(c+1,xPos))==' ')
-            attron(A_BOLD);
-        mvaddch(c,xPos,str[str.size()-1-c]);
-        attroff(A_BOLD);
+        if(c<str.size()-1 && screen.at(c+1,xPos)==' ')
+            screen.attributesOn(A_BOLD);
+        screen.text(c,xPos,std::string_view{&str[str.size()-1-c],1});
+        screen.attributesOff(A_BOLD);
     }
     shiftCharacters();
 }
@@ -1,9 +1,11 @@
 #include <string>
 
+class Screen;
+
 class Raindrop{
 public:
     Raindrop(int xPos, bool startAsBlank);
-    void update();
+    void update(Screen& screen);
     void blankSpace(int length);
 private:
     void shiftCharacters();
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "FlatMap.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+using MovieId = std::uint32_t;
+
+/*
+Movie ids ordered by descending rating (ties broken by id).
+A changed rating is moved into place with a binary search over the
+neighbouring side and a memmove of the ids in between, so a rating
+session only touches the entries it actually reorders.
+*/
+class Ranking
+{
+    std::vector<MovieId> m_order;
+    std::vector<std::uint32_t> m_rank;
+
+    template<class Rating>
+    static bool before(MovieId a, MovieId b, const Rating& rating)
+    {
+        const auto ra{rating(a)};
+        const auto rb{rating(b)};
+        return ra > rb || (ra == rb && a < b);
+    }
+
+    void renumber(std::size_t first, std::size_t last)
+    {
+        for(auto i{first}; i<last; ++i)
+            m_rank[m_order[i]] = static_cast<std::uint32_t>(i);
+    }
+public:
+    template<class Rating>
+    void rebuild(std::size_t count, const Rating& rating)
+    {
+        m_order.resize(count);
+        m_rank.resize(count);
+        std::iota(m_order.begin(),m_order.end(),MovieId{0});
+        std::sort(m_order.begin(),m_order.end(),[&rating](MovieId a, MovieId b){ return before(a,b,rating); });
+        renumber(0,count);
+    }
+
+    template<class Rating>
+    void append(MovieId id, const Rating& rating)
+    {
+        m_order.push_back(id);
+        m_rank.resize(std::max<std::size_t>(m_rank.size(),id+1));
+        m_rank[id] = static_cast<std::uint32_t>(m_order.size()-1);
+        update(id,rating);
+    }
+
+    // Adds the new ids [first,last) in one pass: they are sorted among themselves and merged in.
+    template<class Rating>
+    void append(MovieId first, MovieId last, const Rating& rating)
+    {
+        const auto middle{m_order.size()};
+        m_order.resize(middle+(last-first));
+        std::iota(m_order.begin()+middle,m_order.end(),first);
+        const auto order{[&rating](MovieId a, MovieId b){ return before(a,b,rating); }};
+        std::sort(m_order.begin()+middle,m_order.end(),order);
+        std::inplace_merge(m_order.begin(),m_order.begin()+middle,m_order.end(),order);
+        m_rank.resize(std::max<std::size_t>(m_rank.size(),last));
+        renumber(0,m_order.size());
+    }
+
+    template<class Rating>
+    void update(MovieId id, const Rating& rating)
+    {
+        const std::size_t pos{m_rank[id]};
+        const auto data{m_order.data()};
+        if(pos > 0 && before(id,data[pos-1],rating))
+        {
+            const auto first{std::partition_point(data,data+pos,[&](MovieId other){ return before(other,id,rating); })};
+            const std::size_t target(first-data);
+            std::memmove(data+target+1,data+target,(pos-target)*sizeof(MovieId));
+            data[target] = id;
+            renumber(target,pos+1);
+        }
+        else if(pos+1 < m_order.size() && before(data[pos+1],id,rating))
+        {
+            const auto last{std::partition_point(data+pos+1,data+m_order.size(),[&](MovieId other){ return before(other,id,rating); })};
+            const std::size_t target(last-data-1);
+            std::memmove(data+pos,data+pos+1,(target-pos)*sizeof(MovieId));
+            data[target] = id;
+            renumber(pos,target+1);
+        }
+    }
+
+    // Repositions several changed entries one at a time; entries not yet visited keep their old rating.
+    template<class Rating, class OldRating>
+    void update(const std::vector<MovieId>& ids, const Rating& rating, const OldRating& oldRating)
+    {
+        FlatMap<MovieId,bool> visited;
+        visited.reserve(ids.size());
+        const auto current{[&](MovieId id){ return visited.find(id) ? rating(id) : oldRating(id); }};
+        for(const auto id : ids)
+        {
+            visited[id] = true;
+            update(id,current);
+        }
+    }
+
+    MovieId operator[](std::size_t rank) const { return m_order[rank]; }
+    std::size_t rankOf(MovieId id) const { return m_rank[id]; }
+    std::size_t size() const { return m_order.size(); }
+    auto begin() const { return m_order.begin(); }
+    auto end() const { return m_order.end(); }
+};
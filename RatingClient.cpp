@@ -0,0 +1,126 @@
+#include "RatingClient.h"
+#include "Profiler.h"
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <vector>
+
+RatingClient::RatingClient(const std::string& path) :
+    m_path{path}
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path))
+        return;
+    std::memcpy(address.sun_path,path.c_str(),path.size()+1);
+    m_fd = socket(AF_UNIX,SOCK_STREAM | SOCK_CLOEXEC,0);
+    if(m_fd >= 0 && connect(m_fd,reinterpret_cast<const sockaddr*>(&address),sizeof(address)) != 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+    updates();
+}
+
+RatingClient::~RatingClient()
+{
+    if(m_fd >= 0)
+        close(m_fd);
+}
+
+std::optional<Protocol::Reader> RatingClient::exchange()
+{
+    if(m_fd < 0)
+        return std::nullopt;
+    if(!Protocol::send(m_fd,m_request) || !Protocol::receive(m_fd,m_response))
+    {
+        close(m_fd);
+        m_fd = -1;
+        return std::nullopt;
+    }
+    Protocol::Reader reader{m_response};
+    if(reader.get<Protocol::Status>() != Protocol::Status::Ok)
+        return std::nullopt;
+    return reader;
+}
+
+std::optional<std::uint64_t> RatingClient::updates()
+{
+    m_request.clear();
+    m_request.put(Protocol::Op::Info);
+    auto reader{exchange()};
+    if(!reader)
+        return std::nullopt;
+    m_size = reader->get<std::uint32_t>();
+    const auto updates{reader->get<std::uint64_t>()};
+    return reader->ok() ? std::optional{updates} : std::nullopt;
+}
+
+std::optional<std::pair<RatingClient::Entry,RatingClient::Entry>> RatingClient::pair()
+{
+    m_request.clear();
+    m_request.put(Protocol::Op::Pair);
+    auto reader{exchange()};
+    if(!reader)
+        return std::nullopt;
+    std::pair<Entry,Entry> entries;
+    for(auto* entry : {&entries.first,&entries.second})
+    {
+        entry->id = reader->get<std::uint32_t>();
+        reader->get(entry->movie);
+    }
+    return reader->ok() ? std::optional{std::move(entries)} : std::nullopt;
+}
+
+std::optional<std::pair<double,double>> RatingClient::rate(MovieId first, MovieId second, bool firstWins)
+{
+    m_request.clear();
+    m_request.put(Protocol::Op::Rate).put<std::uint32_t>(first).put<std::uint32_t>(second).put<std::uint8_t>(firstWins);
+    auto reader{exchange()};
+    if(!reader)
+        return std::nullopt;
+    const auto firstRating{reader->get<double>()};
+    const auto secondRating{reader->get<double>()};
+    return reader->ok() ? std::optional{std::pair{firstRating,secondRating}} : std::nullopt;
+}
+
+LoadGenerator::Result LoadGenerator::run(const std::string& path, std::size_t clients, std::chrono::milliseconds duration)
+{
+    std::vector<Profiler::Histogram> latencies(clients);
+    std::vector<std::uint64_t> updates(clients);
+    std::vector<std::thread> threads;
+    const auto start{std::chrono::steady_clock::now()};
+    const auto end{start+duration};
+    for(std::size_t i=0; i<clients; ++i)
+        threads.emplace_back([&,i]{
+            RatingClient client{path};
+            std::uint32_t seed{static_cast<std::uint32_t>(i)};
+            std::uint64_t count{0};
+            while(client.good() && client.size() >= 2 && std::chrono::steady_clock::now() < end)
+            {
+                // Random pairs are chosen locally so each update is a single round trip.
+                seed = seed*1664525u+1013904223u;
+                const auto first{static_cast<MovieId>(seed%client.size())};
+                const auto second{static_cast<MovieId>((first+1+(seed>>8)%(client.size()-1))%client.size())};
+                const auto sent{std::chrono::steady_clock::now()};
+                if(!client.rate(first,second,seed & 1))
+                    break;
+                latencies[i].add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-sent).count());
+                ++count;
+            }
+            updates[i] = count;
+        });
+    for(auto& thread : threads)
+        thread.join();
+    Result result{clients,0,std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count()};
+    Profiler::Histogram all;
+    for(std::size_t i=0; i<clients; ++i)
+    {
+        result.updates += updates[i];
+        all.merge(latencies[i]);
+    }
+    result.p50Us = all.percentile(0.5)/1e3;
+    result.p99Us = all.percentile(0.99)/1e3;
+    return result;
+}
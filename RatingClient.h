@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Protocol.h"
+#include "Ranking.h"
+#include "Records.h"
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+/*
+Blocking client for RatingServer, one request in flight at a time. The
+range and search calls mirror ShardedCatalog's so the read-only views
+can page through either. Any failed exchange closes the connection and
+leaves good() false.
+*/
+class RatingClient
+{
+public:
+    struct Entry
+    {
+        MovieId id{};
+        Records::Movie movie;
+    };
+
+    explicit RatingClient(const std::string& path);
+    ~RatingClient();
+    RatingClient(const RatingClient&) = delete;
+    RatingClient& operator=(const RatingClient&) = delete;
+
+    bool good() const { return m_fd >= 0; }
+    const std::string& path() const { return m_path; }
+    // Movies on the server, as of the last Info exchange.
+    std::size_t size() const { return m_size; }
+    // Comparisons the server has applied, from every client.
+    std::optional<std::uint64_t> updates();
+
+    std::optional<std::pair<Entry,Entry>> pair();
+    // The two new ratings once the server has applied the comparison.
+    std::optional<std::pair<double,double>> rate(MovieId first, MovieId second, bool firstWins);
+
+    // fcn(rank,movie) for ranks [first,first+count) of the server's latest snapshot.
+    template<class F>
+    void forEachInRange(std::size_t first, std::size_t count, F&& fcn)
+    {
+        m_request.clear();
+        m_request.put(Protocol::Op::Range).put<std::uint32_t>(static_cast<std::uint32_t>(first)).put<std::uint32_t>(static_cast<std::uint32_t>(count));
+        forEachRow(fcn);
+    }
+
+    // fcn(rank,movie) for up to Protocol::MaxRows best ranked titles containing query, ignoring case.
+    template<class F>
+    void search(std::string_view query, F&& fcn)
+    {
+        m_request.clear();
+        m_request.put(Protocol::Op::Search).put(Protocol::MaxRows).put(query);
+        forEachRow(fcn);
+    }
+private:
+    std::optional<Protocol::Reader> exchange();
+
+    template<class F>
+    void forEachRow(F& fcn)
+    {
+        auto reader{exchange()};
+        if(!reader)
+            return;
+        Records::Movie movie;
+        for(auto rows{reader->get<std::uint32_t>()}; rows>0 && reader->ok(); --rows)
+        {
+            const auto rank{reader->get<std::uint32_t>()};
+            if(reader->get(movie))
+                fcn(static_cast<std::size_t>(rank),movie);
+        }
+    }
+
+    std::string m_path;
+    int m_fd{-1};
+    std::size_t m_size{0};
+    Protocol::Writer m_request;
+    std::string m_response;
+};
+
+namespace LoadGenerator
+{
+    struct Result
+    {
+        std::size_t clients{};
+        std::uint64_t updates{};
+        double seconds{};
+        double p50Us{};
+        double p99Us{};
+    };
+
+    // Runs clients connections that each rate random pairs as fast as the server answers.
+    Result run(const std::string& path, std::size_t clients, std::chrono::milliseconds duration);
+}
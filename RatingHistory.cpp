@@ -0,0 +1,287 @@
+#include "RatingHistory.h"
+#include "FileWriter.h"
+#include "Profiler.h"
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    constexpr std::uint32_t Magic{0x31485452}; // "RTH1"
+
+    // Appends the low count bits of value, most significant first, at bit of words.
+    void writeBits(std::vector<std::uint64_t>& words, std::uint32_t& bit, std::uint64_t value, unsigned count)
+    {
+        if(count == 0)
+            return;
+        if(count < 64)
+            value &= (std::uint64_t{1} << count)-1;
+        const auto offset{bit%64};
+        if(offset == 0)
+            words.push_back(0);
+        words.back() |= offset+count <= 64 ? value << (64-offset-count) : value >> (offset+count-64);
+        if(offset+count > 64)
+            words.push_back(value << (128-offset-count));
+        bit += count;
+    }
+
+    template<class T>
+    void put(std::string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value),sizeof(value));
+    }
+
+    template<class T>
+    bool get(std::string_view& in, T& value)
+    {
+        if(in.size() < sizeof(value))
+            return false;
+        std::memcpy(&value,in.data(),sizeof(value));
+        in.remove_prefix(sizeof(value));
+        return true;
+    }
+}
+
+RatingHistory::Time RatingHistory::now()
+{
+    // Only seconds are kept, and time() is cheaper than the nanosecond clock on the rating server's vote path.
+    return std::time(nullptr);
+}
+
+void RatingHistory::OpenChunk::append(Time time, double rating)
+{
+    if(chunk.count++ == 0)
+    {
+        chunk.first = chunk.last = {time,rating};
+        return;
+    }
+    // Timestamps: the change in delta, in the smallest of five signed widths or as a raw 64-bit value.
+    const auto next{time-chunk.last.time};
+    const auto dod{next-delta};
+    delta = next;
+    auto& times{chunk.bits};
+    if(dod == 0)
+        writeBits(times,timeBits,0b0,1);
+    else
+    {
+        unsigned prefix{0b11111};
+        unsigned width{64};
+        for(const auto& [code,bits] : TimeCodes)
+            if(dod >= -(Time{1} << (bits-1)) && dod < (Time{1} << (bits-1)))
+            {
+                prefix = code;
+                width = bits;
+                break;
+            }
+        writeBits(times,timeBits,prefix,std::bit_width(prefix));
+        writeBits(times,timeBits,static_cast<std::uint64_t>(dod),width);
+    }
+    // Ratings: nothing when unchanged, else the XOR in the previous window when it fits, else in a new window.
+    const auto diff{std::bit_cast<std::uint64_t>(rating) ^ std::bit_cast<std::uint64_t>(chunk.last.rating)};
+    chunk.last = {time,rating};
+    if(diff == 0)
+    {
+        writeBits(ratings,ratingBits,0b0,1);
+        return;
+    }
+    const auto newLeading{std::min(static_cast<unsigned>(std::countl_zero(diff)),31u)};
+    const auto trailing{static_cast<unsigned>(std::countr_zero(diff))};
+    if(meaningful && newLeading >= leading && trailing >= 64u-leading-meaningful)
+    {
+        writeBits(ratings,ratingBits,0b10,2);
+        writeBits(ratings,ratingBits,diff >> (64-leading-meaningful),meaningful);
+        return;
+    }
+    leading = static_cast<std::uint8_t>(newLeading);
+    meaningful = static_cast<std::uint8_t>(64-newLeading-trailing);
+    writeBits(ratings,ratingBits,0b11,2);
+    writeBits(ratings,ratingBits,leading,5);
+    writeBits(ratings,ratingBits,meaningful-1u,6);
+    writeBits(ratings,ratingBits,diff >> trailing,meaningful);
+}
+
+// The rating column starts on a word boundary after the timestamps so both can be read independently.
+RatingHistory::Chunk RatingHistory::OpenChunk::seal() const
+{
+    auto sealed{chunk};
+    sealed.ratingBit = static_cast<std::uint32_t>(chunk.bits.size()*64);
+    sealed.bits.reserve(chunk.bits.size()+ratings.size());
+    sealed.bits.insert(sealed.bits.end(),ratings.begin(),ratings.end());
+    return sealed;
+}
+
+void RatingHistory::append(MovieId id, Time time, double rating)
+{
+    const auto index{m_index.find(id)};
+    if(!index)
+    {
+        m_index[id] = static_cast<std::uint32_t>(m_series.size());
+        m_series.emplace_back().id = id;
+    }
+    auto& series{index ? m_series[*index] : m_series.back()};
+    if(index)
+        time = std::max(time,series.last().last.time);
+    series.open.append(time,rating);
+    ++m_points;
+    if(series.open.chunk.count == ChunkPoints)
+    {
+        series.chunks.push_back(series.open.seal());
+        series.open = {};
+    }
+}
+
+std::optional<double> RatingHistory::at(MovieId id, Time time) const
+{
+    const auto series{find(id)};
+    if(!series)
+        return std::nullopt;
+    std::optional<double> rating;
+    const auto until{[&](Time pointTime, double pointRating){
+        if(pointTime > time)
+            return false;
+        rating = pointRating;
+        return true;
+    }};
+    const auto& open{series->open};
+    if(open.chunk.count && open.chunk.first.time <= time)
+    {
+        if(open.chunk.last.time <= time)
+            return open.chunk.last.rating;
+        decode(open,until);
+        return rating;
+    }
+    const auto& chunks{series->chunks};
+    const auto next{std::partition_point(chunks.begin(),chunks.end(),[time](const Chunk& chunk){ return chunk.first.time <= time; })};
+    if(next == chunks.begin())
+        return std::nullopt;
+    const auto& chunk{*std::prev(next)};
+    if(chunk.last.time <= time)
+        return chunk.last.rating;
+    decode(chunk,until);
+    return rating;
+}
+
+std::vector<RatingHistory::Mover> RatingHistory::movers(Time from, std::size_t count) const
+{
+    PROFILE_ZONE("history.movers");
+    std::vector<Mover> movers;
+    for(const auto& series : m_series)
+    {
+        // Series untouched since from cannot have moved, which their last header shows without decoding.
+        const auto& last{series.last().last};
+        if(last.time <= from)
+            continue;
+        auto start{at(series.id,from)};
+        if(!start)
+            start = series.chunks.empty() ? series.open.chunk.first.rating : series.chunks.front().first.rating;
+        if(const auto end{last.rating}; end != *start)
+            movers.push_back({series.id,*start,end});
+    }
+    const auto larger{[](const Mover& a, const Mover& b){
+        const auto changeA{std::abs(a.to-a.from)};
+        const auto changeB{std::abs(b.to-b.from)};
+        return changeA != changeB ? changeA > changeB : a.id < b.id;
+    }};
+    count = std::min(count,movers.size());
+    std::partial_sort(movers.begin(),movers.begin()+count,movers.end(),larger);
+    movers.resize(count);
+    return movers;
+}
+
+std::size_t RatingHistory::bytes() const
+{
+    std::size_t total{0};
+    for(const auto& series : m_series)
+    {
+        total += sizeof(Series)+(series.open.chunk.bits.size()+series.open.ratings.size())*sizeof(std::uint64_t);
+        for(const auto& chunk : series.chunks)
+            total += sizeof(Chunk)+chunk.bits.size()*sizeof(std::uint64_t);
+    }
+    return total;
+}
+
+// Magic, series count, then per series its id, chunk count and chunks. An open chunk is written sealed.
+bool RatingHistory::save(const std::string& fileName) const
+{
+    FileWriter writer{fileName};
+    auto& out{writer.buffer()};
+    put(out,Magic);
+    put(out,static_cast<std::uint32_t>(m_series.size()));
+    const auto putChunk{[&out](const Chunk& chunk){
+        put(out,chunk.first);
+        put(out,chunk.last);
+        put(out,chunk.count);
+        put(out,chunk.ratingBit);
+        put(out,static_cast<std::uint32_t>(chunk.bits.size()));
+        out.append(reinterpret_cast<const char*>(chunk.bits.data()),chunk.bits.size()*sizeof(std::uint64_t));
+    }};
+    for(const auto& series : m_series)
+    {
+        put(out,series.id);
+        put(out,static_cast<std::uint32_t>(series.chunks.size()+(series.open.chunk.count > 0)));
+        for(const auto& chunk : series.chunks)
+            putChunk(chunk);
+        if(series.open.chunk.count)
+            putChunk(series.open.seal());
+        writer.flushIfFull();
+    }
+    return writer.commit();
+}
+
+bool RatingHistory::load(const std::string& fileName)
+{
+    PROFILE_ZONE("history.load");
+    m_series.clear();
+    m_index.clear();
+    m_points = 0;
+    auto file{std::ifstream{fileName,std::ios_base::binary}};
+    const std::string data{std::istreambuf_iterator<char>{file},std::istreambuf_iterator<char>{}};
+    std::string_view in{data};
+    std::uint32_t magic{};
+    std::uint32_t seriesCount{};
+    auto valid{get(in,magic) && magic == Magic && get(in,seriesCount)};
+    for(std::uint32_t i=0; valid && i<seriesCount; ++i)
+    {
+        Series series;
+        std::uint32_t chunkCount{};
+        valid = get(in,series.id) && get(in,chunkCount) && chunkCount > 0 && !contains(series.id);
+        for(std::uint32_t j=0; valid && j<chunkCount; ++j)
+        {
+            Chunk chunk;
+            std::uint32_t words{};
+            valid = get(in,chunk.first) && get(in,chunk.last) && get(in,chunk.count) && get(in,chunk.ratingBit) && get(in,words)
+                && chunk.count > 0 && chunk.count <= ChunkPoints && in.size()/sizeof(std::uint64_t) >= words && chunk.ratingBit <= words*64;
+            if(!valid)
+                break;
+            chunk.bits.resize(words);
+            if(words)
+                std::memcpy(chunk.bits.data(),in.data(),words*sizeof(std::uint64_t));
+            in.remove_prefix(words*sizeof(std::uint64_t));
+            m_points += chunk.count;
+            series.chunks.push_back(std::move(chunk));
+        }
+        if(!valid)
+            break;
+        // A partial last chunk was open; reopen it so appends continue filling it.
+        if(series.chunks.back().count < ChunkPoints)
+        {
+            decode(series.chunks.back(),[&series](Time time, double rating){
+                series.open.append(time,rating);
+                return true;
+            });
+            series.chunks.pop_back();
+        }
+        m_index[series.id] = static_cast<std::uint32_t>(m_series.size());
+        m_series.push_back(std::move(series));
+    }
+    if(!valid || !in.empty())
+    {
+        m_series.clear();
+        m_index.clear();
+        m_points = 0;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "FlatMap.h"
+#include "Ranking.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+Rating trajectory of every movie, as (time, rating) points in Gorilla
+form (Pelkonen et al., 2015). Each series is a list of chunks of up to
+ChunkPoints points, compressed as they arrive. A chunk keeps its first
+and last point in the header and two bit columns: timestamps as
+delta-of-delta codes and ratings as the XOR with the previous rating,
+stored as only its meaningful bits. Range queries find chunks by their
+header times and decode only those that straddle the range; a chunk
+entirely before the query time answers from its header.
+*/
+class RatingHistory
+{
+public:
+    // Seconds since the Unix epoch.
+    using Time = std::int64_t;
+    static constexpr std::uint32_t ChunkPoints{128};
+
+    struct Point
+    {
+        Time time{};
+        double rating{};
+    };
+
+    struct Mover
+    {
+        MovieId id{};
+        double from{};
+        double to{};
+    };
+
+    static Time now();
+
+    // Points of one movie must arrive in time order; an earlier time is recorded as the latest so far.
+    void append(MovieId id, Time time, double rating);
+    bool contains(MovieId id) const { return m_index.find(id) != nullptr; }
+
+    // Calls fcn(time, rating) for every point of id with from <= time <= to, in time order.
+    template<class F>
+    void forEach(MovieId id, Time from, Time to, F&& fcn) const;
+    // Latest rating of id at or before time.
+    std::optional<double> at(MovieId id, Time time) const;
+    // The count movies whose rating changed most since from, largest change first.
+    std::vector<Mover> movers(Time from, std::size_t count) const;
+
+    std::size_t series() const { return m_series.size(); }
+    std::size_t points() const { return m_points; }
+    // Bytes held by the series, their chunk headers and compressed columns.
+    std::size_t bytes() const;
+
+    bool save(const std::string& fileName) const;
+    // Replaces the contents with the file; false and empty if it is missing or malformed.
+    bool load(const std::string& fileName);
+
+private:
+    struct Chunk
+    {
+        Point first;
+        Point last;
+        std::uint32_t count{};
+        // Bit offset of the rating column; the timestamp column starts at bit 0.
+        std::uint32_t ratingBit{};
+        std::vector<std::uint64_t> bits;
+    };
+
+    // The chunk being filled. Its columns grow in separate buffers and are joined when it is sealed.
+    struct OpenChunk
+    {
+        Chunk chunk;
+        std::vector<std::uint64_t> ratings;
+        std::uint32_t timeBits{};
+        std::uint32_t ratingBits{};
+        Time delta{};
+        std::uint8_t leading{};
+        std::uint8_t meaningful{};
+
+        void append(Time time, double rating);
+        Chunk seal() const;
+    };
+
+    struct Series
+    {
+        MovieId id{};
+        std::vector<Chunk> chunks;
+        OpenChunk open;
+
+        const Chunk& last() const { return open.chunk.count ? open.chunk : chunks.back(); }
+    };
+
+    // Prefix and width of each delta-of-delta code after the single 0 bit for no change; 11111 is followed by 64 bits.
+    // Gorilla's widths suit fixed-interval samples; votes arrive minutes to days apart, so there are wider steps.
+    static constexpr std::pair<unsigned,unsigned> TimeCodes[]{{0b10,7},{0b110,12},{0b1110,20},{0b11110,32}};
+
+    // Reads past the end of the words as zero bits, so a damaged chunk decodes to garbage rather than out of bounds.
+    class BitReader
+    {
+        const std::vector<std::uint64_t>& m_words;
+        std::size_t m_bit;
+        std::uint64_t word(std::size_t index) const { return index < m_words.size() ? m_words[index] : 0; }
+    public:
+        BitReader(const std::vector<std::uint64_t>& words, std::size_t bit) : m_words{words}, m_bit{bit} {}
+        std::uint64_t read(unsigned count)
+        {
+            if(count == 0)
+                return 0;
+            const auto index{m_bit/64};
+            const auto offset{m_bit%64};
+            m_bit += count;
+            auto value{word(index) << offset};
+            if(offset+count > 64)
+                value |= word(index+1) >> (64-offset);
+            return value >> (64-count);
+        }
+        bool bit() { return read(1); }
+    };
+
+    // Decodes the points of a chunk in order until fcn returns false.
+    template<class F>
+    static void decode(const Chunk& chunk, BitReader times, BitReader ratings, F&& fcn);
+    template<class F>
+    static void decode(const Chunk& chunk, F&& fcn) { decode(chunk,{chunk.bits,0},{chunk.bits,chunk.ratingBit},fcn); }
+    template<class F>
+    static void decode(const OpenChunk& open, F&& fcn) { decode(open.chunk,{open.chunk.bits,0},{open.ratings,0},fcn); }
+    const Series* find(MovieId id) const
+    {
+        const auto index{m_index.find(id)};
+        return index ? &m_series[*index] : nullptr;
+    }
+
+    std::vector<Series> m_series;
+    FlatMap<MovieId,std::uint32_t> m_index;
+    std::size_t m_points{0};
+};
+
+template<class F>
+void RatingHistory::decode(const Chunk& chunk, BitReader times, BitReader ratings, F&& fcn)
+{
+    if(!chunk.count || !fcn(chunk.first.time,chunk.first.rating))
+        return;
+    auto time{chunk.first.time};
+    Time delta{0};
+    auto value{std::bit_cast<std::uint64_t>(chunk.first.rating)};
+    unsigned leading{0};
+    unsigned meaningful{64};
+    const auto signExtend{[](std::uint64_t bits, unsigned width){
+        return static_cast<Time>(bits << (64-width)) >> (64-width);
+    }};
+    for(std::uint32_t i=1; i<chunk.count; ++i)
+    {
+        if(times.bit())
+        {
+            unsigned width{64};
+            for(const auto& code : TimeCodes)
+                if(!times.bit())
+                {
+                    width = code.second;
+                    break;
+                }
+            delta += signExtend(times.read(width),width);
+        }
+        time += delta;
+        if(ratings.bit())
+        {
+            if(ratings.bit())
+            {
+                leading = static_cast<unsigned>(ratings.read(5));
+                meaningful = static_cast<unsigned>(ratings.read(6))+1;
+            }
+            value ^= ratings.read(meaningful) << (64-leading-meaningful);
+        }
+        if(!fcn(time,std::bit_cast<double>(value)))
+            return;
+    }
+}
+
+template<class F>
+void RatingHistory::forEach(MovieId id, Time from, Time to, F&& fcn) const
+{
+    const auto series{find(id)};
+    if(!series || from > to)
+        return;
+    const auto inRange{[&](Time time, double rating){
+        if(time > to)
+            return false;
+        if(time >= from)
+            fcn(time,rating);
+        return true;
+    }};
+    auto chunk{std::partition_point(series->chunks.begin(),series->chunks.end(),[from](const Chunk& chunk){ return chunk.last.time < from; })};
+    for(; chunk!=series->chunks.end() && chunk->first.time <= to; ++chunk)
+        decode(*chunk,inRange);
+    const auto& open{series->open};
+    if(open.chunk.count && open.chunk.last.time >= from && open.chunk.first.time <= to)
+        decode(open,inRange);
+}
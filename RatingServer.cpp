@@ -0,0 +1,299 @@
+#include "RatingServer.h"
+#include "FileWriter.h"
+#include "Profiler.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    constexpr auto SnapshotInterval{200ms};
+
+    std::string lowercase(std::string_view text)
+    {
+        std::string lower{text};
+        std::transform(lower.begin(),lower.end(),lower.begin(),[](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+        return lower;
+    }
+}
+
+RatingServer::RatingServer(std::vector<Records::Movie> movies) :
+    m_movies(movies.size()),
+    m_ratings{std::make_unique<std::atomic<double>[]>(movies.size())}
+{
+    for(MovieId id=0; id<movies.size(); ++id)
+    {
+        m_movies[id] = {m_names.intern(movies[id].name),m_names.intern(lowercase(movies[id].name)),movies[id].year};
+        m_ratings[id].store(movies[id].rating,std::memory_order_relaxed);
+    }
+    publishSnapshot();
+}
+
+RatingServer::~RatingServer()
+{
+    if(m_listenFd >= 0)
+    {
+        close(m_listenFd);
+        unlink(m_path.c_str());
+    }
+}
+
+bool RatingServer::listen(const std::string& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memcpy(address.sun_path,path.c_str(),path.size()+1);
+    m_listenFd = socket(AF_UNIX,SOCK_STREAM | SOCK_CLOEXEC,0);
+    if(m_listenFd < 0)
+        return false;
+    unlink(path.c_str());
+    if(bind(m_listenFd,reinterpret_cast<const sockaddr*>(&address),sizeof(address)) != 0 || ::listen(m_listenFd,64) != 0)
+    {
+        close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    m_path = path;
+    return true;
+}
+
+void RatingServer::run(const std::atomic<bool>& stop)
+{
+    std::thread snapshots{[this,&stop]{ refreshSnapshots(stop); }};
+    while(!stop.load(std::memory_order_relaxed))
+    {
+        pollfd listener{m_listenFd,POLLIN,0};
+        if(poll(&listener,1,100) <= 0)
+            continue;
+        const auto fd{accept4(m_listenFd,nullptr,nullptr,SOCK_CLOEXEC)};
+        if(fd < 0)
+            continue;
+        const std::lock_guard lock{m_connectionsMutex};
+        m_connections.remove_if([](Connection& connection){
+            if(!connection.done.load(std::memory_order_acquire))
+                return false;
+            connection.thread.join();
+            return true;
+        });
+        auto& connection{m_connections.emplace_back(fd)};
+        connection.thread = std::thread{[this,&connection]{ serve(connection); }};
+    }
+    {
+        const std::lock_guard lock{m_connectionsMutex};
+        for(auto& connection : m_connections)
+            shutdown(connection.fd,SHUT_RDWR);
+    }
+    for(auto& connection : m_connections)
+        connection.thread.join();
+    m_connections.clear();
+    snapshots.join();
+}
+
+void RatingServer::serve(Connection& connection)
+{
+    std::string request;
+    Protocol::Writer response;
+    while(Protocol::receive(connection.fd,request))
+    {
+        response.clear();
+        handle(request,response);
+        if(!Protocol::send(connection.fd,response))
+            break;
+    }
+    {
+        // Closed under the lock so run() never shuts down a descriptor number that has been reused.
+        const std::lock_guard lock{m_connectionsMutex};
+        close(connection.fd);
+        connection.fd = -1;
+    }
+    connection.done.store(true,std::memory_order_release);
+}
+
+void RatingServer::handle(std::string_view request, Protocol::Writer& response)
+{
+    PROFILE_ZONE("server.request");
+    Protocol::Reader reader{request};
+    const auto op{reader.get<Protocol::Op>()};
+    const auto snapshot{m_snapshot.load(std::memory_order_acquire)};
+    const auto count{static_cast<MovieId>(m_movies.size())};
+    const auto fail{[&response]{
+        response.clear();
+        response.put(Protocol::Status::Error);
+    }};
+    response.put(Protocol::Status::Ok);
+    switch(op)
+    {
+        case Protocol::Op::Info:
+        {
+            response.put<std::uint32_t>(count).put<std::uint64_t>(updates());
+            break;
+        }
+        case Protocol::Op::Pair:
+        {
+            if(count < 2)
+                return fail();
+            thread_local std::mt19937 rng{std::random_device{}()};
+            std::uniform_int_distribution<MovieId> pick{0,count-1};
+            const auto first{pick(rng)};
+            auto second{pick(rng)};
+            while(second == first)
+                second = pick(rng);
+            for(const auto id : {first,second})
+                response.put<std::uint32_t>(id).put(movie(id,m_ratings[id].load(std::memory_order_relaxed)));
+            break;
+        }
+        case Protocol::Op::Rate:
+        {
+            const auto first{reader.get<std::uint32_t>()};
+            const auto second{reader.get<std::uint32_t>()};
+            const auto firstWins{reader.get<std::uint8_t>()};
+            if(!reader.ok() || first >= count || second >= count || first == second)
+                return fail();
+            const auto [firstRating,secondRating]{rate(first,second,firstWins != 0)};
+            response.put(firstRating).put(secondRating);
+            break;
+        }
+        case Protocol::Op::Search:
+        {
+            const auto limit{std::min(reader.get<std::uint32_t>(),Protocol::MaxRows)};
+            const auto query{lowercase(reader.rest())};
+            if(!reader.ok())
+                return fail();
+            const auto foundOffset{response.offset()};
+            std::uint32_t found{0};
+            response.put(found);
+            for(std::size_t rank=0; rank<count && found<limit; ++rank)
+            {
+                const auto id{snapshot->ranking[rank]};
+                if(m_names[m_movies[id].lower].find(query) == std::string_view::npos)
+                    continue;
+                response.put<std::uint32_t>(static_cast<std::uint32_t>(rank)).put(movie(id,snapshot->ratings[id]));
+                ++found;
+            }
+            response.patch(foundOffset,found);
+            break;
+        }
+        case Protocol::Op::Range:
+        {
+            const auto first{reader.get<std::uint32_t>()};
+            const auto wanted{std::min(reader.get<std::uint32_t>(),Protocol::MaxRows)};
+            if(!reader.ok())
+                return fail();
+            const auto last{std::min<std::size_t>(count,static_cast<std::size_t>(first)+wanted)};
+            response.put<std::uint32_t>(static_cast<std::uint32_t>(last > first ? last-first : 0));
+            for(auto rank{static_cast<std::size_t>(first)}; rank<last; ++rank)
+            {
+                const auto id{snapshot->ranking[rank]};
+                response.put<std::uint32_t>(static_cast<std::uint32_t>(rank)).put(movie(id,snapshot->ratings[id]));
+            }
+            break;
+        }
+        default:
+            return fail();
+    }
+}
+
+std::pair<double,double> RatingServer::rate(MovieId first, MovieId second, bool firstWins)
+{
+    auto& a{m_stripes[first%Stripes].mutex};
+    auto& b{m_stripes[second%Stripes].mutex};
+    std::unique_lock lockA{a,std::defer_lock};
+    std::unique_lock lockB{b,std::defer_lock};
+    if(&a == &b)
+        lockA.lock();
+    else
+        std::lock(lockA,lockB);
+    const auto previousFirst{m_ratings[first].load(std::memory_order_relaxed)};
+    const auto previousSecond{m_ratings[second].load(std::memory_order_relaxed)};
+    const auto ratings{Utils::computeElo(previousFirst,previousSecond,firstWins)};
+    m_ratings[first].store(ratings.first,std::memory_order_relaxed);
+    m_ratings[second].store(ratings.second,std::memory_order_relaxed);
+    m_updates.fetch_add(1,std::memory_order_relaxed);
+    const auto now{RatingHistory::now()};
+    m_stripes[first%Stripes].comparisons.push_back(firstWins ? Records::Comparison{first,second} : Records::Comparison{second,first});
+    m_stripes[first%Stripes].changes.push_back({first,now,previousFirst,ratings.first});
+    m_stripes[second%Stripes].changes.push_back({second,now,previousSecond,ratings.second});
+    return ratings;
+}
+
+void RatingServer::refreshSnapshots(const std::atomic<bool>& stop)
+{
+    while(!stop.load(std::memory_order_relaxed))
+    {
+        std::this_thread::sleep_for(SnapshotInterval);
+        if(updates() != m_snapshot.load(std::memory_order_acquire)->updates)
+            publishSnapshot();
+    }
+}
+
+void RatingServer::publishSnapshot()
+{
+    PROFILE_ZONE("server.snapshot");
+    auto snapshot{std::make_shared<Snapshot>()};
+    snapshot->updates = updates();
+    snapshot->ratings.resize(m_movies.size());
+    for(MovieId id=0; id<m_movies.size(); ++id)
+        snapshot->ratings[id] = m_ratings[id].load(std::memory_order_relaxed);
+    snapshot->ranking.rebuild(m_movies.size(),[&ratings = snapshot->ratings](MovieId id){ return ratings[id]; });
+    m_snapshot.store(std::move(snapshot),std::memory_order_release);
+}
+
+Records::Movie RatingServer::movie(MovieId id, double rating) const
+{
+    return {rating,std::string{m_names[m_movies[id].name]},m_movies[id].year};
+}
+
+bool RatingServer::save(const std::string& catalog, const std::string& comparisons, const std::string& history)
+{
+    FileWriter writer{catalog};
+    Records::Movie record;
+    for(MovieId id=0; id<m_movies.size(); ++id)
+    {
+        record.rating = m_ratings[id].load(std::memory_order_relaxed);
+        record.name = m_names[m_movies[id].name];
+        record.year = m_movies[id].year;
+        Records::encodeText(record,writer.buffer());
+        writer.flushIfFull();
+    }
+    if(!writer.commit())
+        return false;
+
+    // Takes what the stripes recorded so far; votes made meanwhile are kept for the next save.
+    std::vector<Records::Comparison> allComparisons;
+    auto comparisonsFile{std::fstream{comparisons,std::ios_base::in}};
+    Records::load<Records::Comparison>(comparisonsFile,[&allComparisons](const Records::Comparison& comparison){ allComparisons.push_back(comparison); });
+    comparisonsFile.close();
+    RatingHistory allHistory;
+    allHistory.load(history);
+    std::vector<Change> changes;
+    for(auto& stripe : m_stripes)
+    {
+        {
+            const std::lock_guard lock{stripe.mutex};
+            allComparisons.insert(allComparisons.end(),stripe.comparisons.begin(),stripe.comparisons.end());
+            stripe.comparisons.clear();
+            changes.swap(stripe.changes);
+        }
+        // A movie's changes are all in its stripe, in order. Its first point is the rating it replaced, as the local catalog records them.
+        for(const auto& change : changes)
+        {
+            if(!allHistory.contains(change.id))
+                allHistory.append(change.id,change.time,change.previous);
+            if(change.rating != change.previous)
+                allHistory.append(change.id,change.time,change.rating);
+        }
+        changes.clear();
+    }
+    return Records::serializeToFile(comparisons,allComparisons) && allHistory.save(history);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Protocol.h"
+#include "Ranking.h"
+#include "RatingHistory.h"
+#include "Records.h"
+#include "TitlePool.h"
+#include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Shared catalog for several raters, served over a Unix domain socket with
+one thread per connection. Ratings are atomics: a comparison locks the
+stripes of its two movies, so pairs on different stripes commit in
+parallel, and readers never lock. Each comparison and the history points
+it produces are kept in the stripes already locked for it, and written to
+the same files the local catalog keeps them in, so the Bradley-Terry fit
+and the history view see every rater's votes. Search and Range are
+answered from an immutable ranking snapshot that a background thread
+rebuilds while ratings keep changing, then swaps in atomically.
+*/
+class RatingServer
+{
+public:
+    static constexpr std::size_t Stripes{256};
+
+    explicit RatingServer(std::vector<Records::Movie> movies);
+    ~RatingServer();
+    RatingServer(const RatingServer&) = delete;
+    RatingServer& operator=(const RatingServer&) = delete;
+
+    // Binds the socket, replacing a stale one at the same path.
+    bool listen(const std::string& path);
+    // Serves connections until stop becomes true, then closes them all.
+    void run(const std::atomic<bool>& stop);
+
+    // Applies and records one comparison and returns the two new ratings.
+    std::pair<double,double> rate(MovieId first, MovieId second, bool firstWins);
+    std::size_t size() const { return m_movies.size(); }
+    std::uint64_t updates() const { return m_updates.load(std::memory_order_relaxed); }
+    // Writes the current ratings to the catalog file and adds the comparisons and history recorded since the last save to theirs.
+    bool save(const std::string& catalog, const std::string& comparisons, const std::string& history);
+private:
+    struct Title
+    {
+        TitlePool::Handle name{};
+        TitlePool::Handle lower{};
+        int year{};
+    };
+
+    struct Snapshot
+    {
+        std::vector<double> ratings;
+        Ranking ranking;
+        std::uint64_t updates{0};
+    };
+
+    // A rating change as it happened; compressed into the history only when saved.
+    struct Change
+    {
+        MovieId id{};
+        RatingHistory::Time time{};
+        double previous{};
+        double rating{};
+    };
+
+    // Guards the ratings of its movies. The comparisons whose first movie it holds and the changes to its movies are kept here.
+    struct alignas(64) Stripe
+    {
+        std::mutex mutex;
+        std::vector<Records::Comparison> comparisons;
+        std::vector<Change> changes;
+    };
+
+    struct Connection
+    {
+        int fd;
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    void serve(Connection& connection);
+    void handle(std::string_view request, Protocol::Writer& response);
+    void refreshSnapshots(const std::atomic<bool>& stop);
+    void publishSnapshot();
+    Records::Movie movie(MovieId id, double rating) const;
+
+    TitlePool m_names;
+    std::vector<Title> m_movies;
+    std::unique_ptr<std::atomic<double>[]> m_ratings;
+    std::array<Stripe,Stripes> m_stripes;
+    std::atomic<std::uint64_t> m_updates{0};
+    std::atomic<std::shared_ptr<const Snapshot>> m_snapshot;
+
+    std::string m_path;
+    int m_listenFd{-1};
+    std::mutex m_connectionsMutex;
+    std::list<Connection> m_connections;
+};
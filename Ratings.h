@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+Rating column split into fixed-size pages behind a shared page table.
+Copying a column is O(1): both copies share the table until one of them
+writes, at which point only the table and the touched page are cloned.
+Columns derived from each other can be diffed by skipping shared pages.
+*/
+class Ratings
+{
+public:
+    static constexpr std::size_t PageSize{1024};
+
+    double operator[](std::size_t index) const
+    {
+        return (*(*m_table)[index/PageSize])[index%PageSize];
+    }
+
+    void set(std::size_t index, double rating)
+    {
+        writable(index/PageSize)[index%PageSize] = rating;
+        m_stamp = ++s_stamps;
+    }
+
+    void push_back(double rating)
+    {
+        if(m_size%PageSize == 0)
+        {
+            detach();
+            m_table->push_back(std::make_shared<Page>());
+        }
+        set(m_size++,rating);
+    }
+
+    // Every page points at one shared constant page until written to.
+    void fill(double rating)
+    {
+        auto page{std::make_shared<Page>()};
+        page->fill(rating);
+        m_table = std::make_shared<Table>(m_table->size(),page);
+        m_stamp = ++s_stamps;
+    }
+
+    // Calls fcn(firstIndex, ratings, count) once per page, in index order.
+    template<class F>
+    void forEachPage(F&& fcn) const
+    {
+        for(std::size_t page=0; page<m_table->size(); ++page)
+        {
+            const auto first{page*PageSize};
+            fcn(first,(*m_table)[page]->data(),std::min(PageSize,m_size-first));
+        }
+    }
+
+    // Calls fcn(index, mine, theirs) for every differing entry, comparing only pages that are not shared.
+    template<class F>
+    void forEachDiff(const Ratings& other, F&& fcn) const
+    {
+        if(m_table == other.m_table)
+            return;
+        for(std::size_t page=0; page<m_table->size(); ++page)
+        {
+            const auto& mine{(*m_table)[page]};
+            const auto theirs{page < other.m_table->size() ? (*other.m_table)[page].get() : nullptr};
+            if(mine.get() == theirs)
+                continue;
+            const auto first{page*PageSize};
+            const auto last{std::min(first+PageSize,m_size)};
+            for(auto index{first}; index<last; ++index)
+            {
+                const auto theirRating{theirs && index < other.m_size ? (*theirs)[index%PageSize] : 0.0};
+                if((*mine)[index%PageSize] != theirRating)
+                    fcn(static_cast<std::uint32_t>(index),(*mine)[index%PageSize],theirRating);
+            }
+        }
+    }
+
+    // Identifies the column's contents: copies share it until either side is modified.
+    std::uint64_t stamp() const { return m_stamp; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+private:
+    using Page = std::array<double,PageSize>;
+    using Table = std::vector<std::shared_ptr<Page>>;
+
+    std::shared_ptr<Table> m_table{std::make_shared<Table>()};
+    std::size_t m_size{0};
+    std::uint64_t m_stamp{0};
+    inline static std::uint64_t s_stamps{0};
+
+    void detach()
+    {
+        if(m_table.use_count() > 1)
+            m_table = std::make_shared<Table>(*m_table);
+    }
+
+    Page& writable(std::size_t page)
+    {
+        detach();
+        auto& slot{(*m_table)[page]};
+        if(slot.use_count() > 1)
+            slot = std::make_shared<Page>(*slot);
+        return *slot;
+    }
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "FlatMap.h"
+#include "Profiler.h"
+#include "Ranking.h"
+#include "Ratings.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/*
+Top-N recommendations scored from rating, session momentum, release year
+and how unexplored a movie is. All terms are computed in one pass over the
+rating pages while a bounded min-heap keeps the best candidates, and the
+result is reused until the rating column or the session diffs change.
+*/
+class Recommender
+{
+public:
+    struct Weights
+    {
+        double rating{1.0};
+        double momentum{0.5};
+        double recency{0.3};
+        double unexplored{0.4};
+    };
+
+    struct Candidate
+    {
+        MovieId id{};
+        double score{};
+        double rating{};
+        double momentum{};
+        double recency{};
+        double unexplored{};
+    };
+
+    void setWeights(const Weights& weights)
+    {
+        m_weights = weights;
+        invalidate();
+    }
+
+    // year(id) returns a movie's release year; sessionGeneration changes whenever session does.
+    template<class Year>
+    const std::vector<Candidate>& top(std::size_t n, const Ratings& ratings, const FlatMap<MovieId,double>& session, std::uint64_t sessionGeneration,
+                                      const Year& year, int currentYear)
+    {
+        if(m_valid && m_stamp == ratings.stamp() && m_sessionGeneration == sessionGeneration && m_count == n && m_size == ratings.size())
+            return m_top;
+
+        PROFILE_ZONE("recommend.top");
+        m_top.clear();
+        ratings.forEachPage([&](std::size_t first, const double* page, std::size_t count)
+        {
+            for(std::size_t i=0; i<count; ++i)
+            {
+                const auto id{static_cast<MovieId>(first+i)};
+                offer(m_top,n,score(id,page[i],session.find(id),year(id),currentYear));
+            }
+        });
+        std::sort_heap(m_top.begin(),m_top.end(),better);
+
+        m_valid = true;
+        m_stamp = ratings.stamp();
+        m_sessionGeneration = sessionGeneration;
+        m_count = n;
+        m_size = ratings.size();
+        return m_top;
+    }
+
+    void invalidate() { m_valid = false; }
+
+    // diff is the movie's rating change this session, or null.
+    Candidate score(MovieId id, double rating, const double* diff, int year, int currentYear) const
+    {
+        Candidate candidate{id};
+        candidate.rating = (rating-Default)/EloScale;
+        candidate.momentum = diff ? *diff/K : 0.0;
+        candidate.recency = (year-FirstYear)/(currentYear-FirstYear);
+        candidate.unexplored = diff ? 0.0 : std::exp(-std::abs(rating-Default)/K);
+        candidate.score = m_weights.rating*candidate.rating
+                        + m_weights.momentum*candidate.momentum
+                        + m_weights.recency*candidate.recency
+                        + m_weights.unexplored*candidate.unexplored;
+        return candidate;
+    }
+
+    // Highest score a movie rated at most `rating` can reach without a session diff.
+    double bound(double rating) const
+    {
+        return m_weights.rating*(rating-Default)/EloScale + std::max(0.0,m_weights.recency) + std::max(0.0,m_weights.unexplored);
+    }
+
+    static bool better(const Candidate& a, const Candidate& b) { return a.score > b.score; }
+
+    // Keeps the n best candidates in a min-heap on score; finish with std::sort_heap(..., better).
+    static void offer(std::vector<Candidate>& heap, std::size_t n, const Candidate& candidate)
+    {
+        if(heap.size() < n)
+        {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(),heap.end(),better);
+        }
+        else if(n > 0 && candidate.score > heap.front().score)
+        {
+            std::pop_heap(heap.begin(),heap.end(),better);
+            heap.back() = candidate;
+            std::push_heap(heap.begin(),heap.end(),better);
+        }
+    }
+
+private:
+    static constexpr auto Default{1000.0};
+    static constexpr auto EloScale{400.0};
+    static constexpr auto K{32.0};
+    static constexpr auto FirstYear{1900.0};
+
+    Weights m_weights;
+    std::vector<Candidate> m_top;
+    bool m_valid{false};
+    std::uint64_t m_stamp{0};
+    std::uint64_t m_sessionGeneration{0};
+    std::size_t m_count{0};
+    std::size_t m_size{0};
+};
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "FileWriter.h"
+#include "Utils.h"
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/*
+On-disk record types and their codecs. Each record type lists its fields
+once in a Descriptor; the comma separated text format and the binary
+format are both generated from that list at compile time. Titles
+containing commas or quotes are written as quoted CSV fields.
+*/
+namespace Records
+{
+    struct Movie
+    {
+        double rating{};
+        std::string name;
+        int year{};
+    };
+
+    struct Score
+    {
+        int score{};
+        std::string timestamp;
+    };
+
+    // One rating decision, by movie id.
+    struct Comparison
+    {
+        std::uint32_t winner{};
+        std::uint32_t loser{};
+    };
+
+    // Start of a recorded input session: what a replay needs to reproduce it.
+    struct SessionHeader
+    {
+        std::uint32_t magic{};
+        std::uint64_t seed{};
+        std::int32_t lines{};
+        std::int32_t columns{};
+        std::string terminal;
+    };
+
+    // One key read by a view, or ERR for a timeout that expired, after ms milliseconds of the session.
+    struct Keystroke
+    {
+        std::uint32_t ms{};
+        std::int32_t key{};
+    };
+
+    template<class T, class M>
+    struct Field
+    {
+        std::string_view name;
+        M T::* member;
+    };
+
+    // Specialise with a constexpr tuple of Fields, in on-disk order, to make a type serializable.
+    template<class T>
+    struct Descriptor;
+
+    template<>
+    struct Descriptor<Movie>
+    {
+        static constexpr std::tuple fields{
+            Field<Movie,double>{"rating",&Movie::rating},
+            Field<Movie,std::string>{"name",&Movie::name},
+            Field<Movie,int>{"year",&Movie::year}};
+    };
+
+    template<>
+    struct Descriptor<Score>
+    {
+        static constexpr std::tuple fields{
+            Field<Score,int>{"score",&Score::score},
+            Field<Score,std::string>{"timestamp",&Score::timestamp}};
+    };
+
+    template<>
+    struct Descriptor<Comparison>
+    {
+        static constexpr std::tuple fields{
+            Field<Comparison,std::uint32_t>{"winner",&Comparison::winner},
+            Field<Comparison,std::uint32_t>{"loser",&Comparison::loser}};
+    };
+
+    template<>
+    struct Descriptor<SessionHeader>
+    {
+        static constexpr std::tuple fields{
+            Field<SessionHeader,std::uint32_t>{"magic",&SessionHeader::magic},
+            Field<SessionHeader,std::uint64_t>{"seed",&SessionHeader::seed},
+            Field<SessionHeader,std::int32_t>{"lines",&SessionHeader::lines},
+            Field<SessionHeader,std::int32_t>{"columns",&SessionHeader::columns},
+            Field<SessionHeader,std::string>{"terminal",&SessionHeader::terminal}};
+    };
+
+    template<>
+    struct Descriptor<Keystroke>
+    {
+        static constexpr std::tuple fields{
+            Field<Keystroke,std::uint32_t>{"ms",&Keystroke::ms},
+            Field<Keystroke,std::int32_t>{"key",&Keystroke::key}};
+    };
+
+    template<class T, class F>
+    constexpr void forEachField(F&& fcn)
+    {
+        std::apply([&fcn](const auto&... field){ (fcn(field),...); },Descriptor<T>::fields);
+    }
+
+    template<class M>
+    constexpr bool Arithmetic{std::is_arithmetic_v<M>};
+
+    template<class M>
+    constexpr std::size_t binaryFieldSize() { return Arithmetic<M> ? sizeof(M) : sizeof(std::uint32_t); }
+
+    // Bytes of the binary record before any string contents.
+    template<class T>
+    constexpr std::size_t binaryFixedSize()
+    {
+        return std::apply([](const auto&... field){
+            return (binaryFieldSize<std::remove_cvref_t<decltype(std::declval<T&>().*field.member)>>()+...+0);
+        },Descriptor<T>::fields);
+    }
+
+    // Appends one record and its line break to out.
+    template<class T>
+    void encodeText(const T& object, std::string& out)
+    {
+        auto first{true};
+        forEachField<T>([&](const auto& field){
+            using M = std::remove_cvref_t<decltype(object.*field.member)>;
+            if(!first)
+                out += ',';
+            first = false;
+            if constexpr (Arithmetic<M>)
+            {
+                char digits[32];
+                const auto end{std::to_chars(digits,digits+sizeof(digits),object.*field.member).ptr};
+                out.append(digits,end);
+            }
+            else
+                Utils::appendCsvField(out,object.*field.member);
+        });
+        out += '\n';
+    }
+
+    // Decodes one line in place; missing fields are left at their defaults.
+    template<class T>
+    T decodeText(std::string& line)
+    {
+        Utils::CsvScanner scanner{line};
+        T object;
+        forEachField<T>([&](const auto& field){
+            using M = std::remove_cvref_t<decltype(object.*field.member)>;
+            const auto text{scanner.next().value_or(std::string_view{})};
+            if constexpr (Arithmetic<M>)
+                std::from_chars(text.data(),text.data()+text.size(),object.*field.member);
+            else
+                object.*field.member = text;
+        });
+        return object;
+    }
+
+    // Little-endian fixed layout: arithmetic fields as raw bytes, strings as a 32-bit length followed by the bytes.
+    template<class T>
+    void encodeBinary(const T& object, std::string& out)
+    {
+        static_assert(std::endian::native == std::endian::little,"Binary records are stored little-endian");
+        const auto start{out.size()};
+        std::size_t size{binaryFixedSize<T>()};
+        forEachField<T>([&](const auto& field){
+            if constexpr (!Arithmetic<std::remove_cvref_t<decltype(object.*field.member)>>)
+                size += (object.*field.member).size();
+        });
+        out.resize(start+size);
+        auto pos{out.data()+start};
+        forEachField<T>([&](const auto& field){
+            using M = std::remove_cvref_t<decltype(object.*field.member)>;
+            const auto& value{object.*field.member};
+            if constexpr (Arithmetic<M>)
+            {
+                std::memcpy(pos,&value,sizeof(M));
+                pos += sizeof(M);
+            }
+            else
+            {
+                const auto length{static_cast<std::uint32_t>(value.size())};
+                std::memcpy(pos,&length,sizeof(length));
+                std::memcpy(pos+sizeof(length),value.data(),length);
+                pos += sizeof(length)+length;
+            }
+        });
+    }
+
+    // Decodes the record at the front of in into object, reusing its string storage, and advances past it; false if in is truncated.
+    template<class T>
+    bool decodeBinary(std::string_view& in, T& object)
+    {
+        auto pos{in.data()};
+        const auto end{in.data()+in.size()};
+        auto valid{true};
+        forEachField<T>([&](const auto& field){
+            using M = std::remove_cvref_t<decltype(object.*field.member)>;
+            const auto need{binaryFieldSize<M>()};
+            if(!valid || static_cast<std::size_t>(end-pos) < need)
+            {
+                valid = false;
+                return;
+            }
+            if constexpr (Arithmetic<M>)
+                std::memcpy(&(object.*field.member),pos,sizeof(M));
+            else
+            {
+                std::uint32_t length;
+                std::memcpy(&length,pos,sizeof(length));
+                if(static_cast<std::size_t>(end-pos-sizeof(length)) < length)
+                {
+                    valid = false;
+                    return;
+                }
+                (object.*field.member).assign(pos+sizeof(length),length);
+                pos += length;
+            }
+            pos += need;
+        });
+        if(valid)
+            in.remove_prefix(pos-in.data());
+        return valid;
+    }
+
+    template<class T>
+    std::optional<T> decodeBinary(std::string_view& in)
+    {
+        T object;
+        if(!decodeBinary(in,object))
+            return std::nullopt;
+        return object;
+    }
+
+    template<class T>
+    std::string serialize(const T& object)
+    {
+        std::string str;
+        encodeText(object,str);
+        return str;
+    }
+
+    // Calls fcn with every non-empty line of the stream decoded as a T.
+    template<class T, class F>
+    void load(std::istream& is, F&& fcn)
+    {
+        std::string str;
+        while(std::getline(is,str))
+        {
+            if(!str.empty() && str.back() == '\r')
+                str.pop_back();
+            if(!str.empty())
+                fcn(decodeText<T>(str));
+        }
+    }
+
+    // Replaces the file with data, formatted in large batches and renamed into place once complete.
+    template<class T>
+    bool serializeToFile(const std::string& fileName, const std::vector<T>& data)
+    {
+        FileWriter writer{fileName};
+        for(const auto& object : data)
+        {
+            encodeText(object,writer.buffer());
+            writer.flushIfFull();
+        }
+        return writer.commit();
+    }
+}
@@ -0,0 +1,258 @@
+#include "Screen.h"
+#include "Profiler.h"
+#include "Session.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <langinfo.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr std::uint32_t Blank{' '};
+    // Longest gap the cursor crosses by rewriting the cells in it rather than with an escape sequence.
+    constexpr auto MaxRewrite{8};
+
+    std::size_t glyphLength(std::uint32_t glyph)
+    {
+        const auto lead{glyph & 0xff};
+        return lead < 0x80 ? 1 : lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : 2;
+    }
+
+    // Packs the UTF-8 character at the front of text into a glyph, first byte lowest, and removes it.
+    std::uint32_t takeGlyph(std::string_view& text)
+    {
+        const auto length{std::min(glyphLength(static_cast<unsigned char>(text.front())),text.size())};
+        std::uint32_t glyph{0};
+        for(std::size_t i=0; i<length; ++i)
+            glyph |= static_cast<std::uint32_t>(static_cast<unsigned char>(text[i])) << (8*i);
+        text.remove_prefix(length);
+        return glyph;
+    }
+
+    void appendColor(std::string& out, short color, int base, int brightBase)
+    {
+        if(color < 0)
+            return;
+        char code[8];
+        out.append(code,std::snprintf(code,sizeof(code),";%d",color < 8 ? base+color : brightBase+color-8));
+    }
+}
+
+Screen::Screen(WINDOW* window, Renderer renderer) :
+    m_window{window},
+    m_renderer{renderer},
+    m_attributes{static_cast<attr_t>(getattrs(window))}
+{
+    getbegyx(window,m_top,m_left);
+    getmaxyx(window,m_rows,m_columns);
+    if(m_renderer == Renderer::Direct)
+    {
+        m_cells.assign(static_cast<std::size_t>(m_rows)*m_columns,{Blank,A_NORMAL});
+        m_shown.assign(m_cells.size(),{});
+    }
+}
+
+Screen::~Screen()
+{
+    release();
+}
+
+bool Screen::unicode()
+{
+    static const bool unicode{std::string_view{nl_langinfo(CODESET)} == "UTF-8"};
+    return unicode;
+}
+
+const char* Screen::name(Renderer renderer)
+{
+    return renderer == Renderer::Direct ? "direct" : "ncurses";
+}
+
+void Screen::text(int y, int x, std::string_view text)
+{
+    if(m_renderer == Renderer::Curses)
+    {
+        wattrset(m_window,m_attributes);
+        mvwaddnstr(m_window,y,x,text.data(),static_cast<int>(text.size()));
+        return;
+    }
+    if(y < 0 || y >= m_rows || x < 0)
+        return;
+    const auto row{m_cells.begin()+static_cast<std::ptrdiff_t>(y)*m_columns};
+    for(; !text.empty() && x<m_columns; ++x)
+        row[x] = {takeGlyph(text),m_attributes};
+}
+
+int Screen::at(int y, int x) const
+{
+    if(m_renderer == Renderer::Curses)
+        return static_cast<int>(mvwinch(m_window,y,x) & A_CHARTEXT);
+    if(y < 0 || y >= m_rows || x < 0 || x >= m_columns)
+        return 0;
+    const auto glyph{m_cells[static_cast<std::size_t>(y)*m_columns+x].glyph};
+    return glyph < 0x80 ? static_cast<int>(glyph) : 0;
+}
+
+void Screen::blank()
+{
+    if(m_renderer == Renderer::Curses)
+        werase(m_window);
+    else
+        std::fill(m_cells.begin(),m_cells.end(),Cell{Blank,A_NORMAL});
+}
+
+void Screen::outline()
+{
+    if(m_renderer == Renderer::Curses)
+    {
+        wattrset(m_window,m_attributes);
+        ::box(m_window,0,0);
+        return;
+    }
+    if(m_rows < 2 || m_columns < 2)
+        return;
+    const auto unicode{Screen::unicode()};
+    const auto horizontal{unicode ? "─" : "-"};
+    const auto vertical{unicode ? "│" : "|"};
+    for(int x=1; x<m_columns-1; ++x)
+    {
+        text(0,x,horizontal);
+        text(m_rows-1,x,horizontal);
+    }
+    for(int y=1; y<m_rows-1; ++y)
+    {
+        text(y,0,vertical);
+        text(y,m_columns-1,vertical);
+    }
+    text(0,0,unicode ? "┌" : "+");
+    text(0,m_columns-1,unicode ? "┐" : "+");
+    text(m_rows-1,0,unicode ? "└" : "+");
+    text(m_rows-1,m_columns-1,unicode ? "┘" : "+");
+}
+
+void Screen::moveTo(int y, int x)
+{
+    if(m_cursorY == y && m_cursorX == x)
+        return;
+    char absolute[32];
+    const auto absoluteLength{static_cast<std::size_t>(std::snprintf(absolute,sizeof(absolute),"\x1b[%d;%dH",m_top+y+1,m_left+x+1))};
+    if(m_cursorY == y && m_cursorX >= 0 && m_cursorX < x)
+    {
+        char relative[16];
+        const auto gap{x-m_cursorX};
+        const auto relativeLength{static_cast<std::size_t>(gap == 1 ? std::snprintf(relative,sizeof(relative),"\x1b[C") : std::snprintf(relative,sizeof(relative),"\x1b[%dC",gap))};
+        // The cells in between are already on the terminal; writing them again moves the cursor too.
+        const auto shown{m_shown.begin()+static_cast<std::ptrdiff_t>(y)*m_columns};
+        auto rewrite{gap <= MaxRewrite && m_attributesKnown};
+        std::size_t rewriteLength{0};
+        for(auto i{m_cursorX}; rewrite && i<x; ++i)
+        {
+            rewrite = shown[i].glyph && shown[i].attributes == m_terminalAttributes;
+            rewriteLength += glyphLength(shown[i].glyph);
+        }
+        if(rewrite && rewriteLength <= std::min(relativeLength,absoluteLength))
+        {
+            for(auto i{m_cursorX}; i<x; ++i)
+                appendGlyph(shown[i].glyph);
+        }
+        else if(relativeLength < absoluteLength)
+            m_out.append(relative,relativeLength);
+        else
+            m_out.append(absolute,absoluteLength);
+    }
+    else
+        m_out.append(absolute,absoluteLength);
+    m_cursorY = y;
+    m_cursorX = x;
+}
+
+void Screen::appendGlyph(std::uint32_t glyph)
+{
+    for(auto length{glyphLength(glyph)}; length--; glyph >>= 8)
+        m_out += static_cast<char>(glyph & 0xff);
+}
+
+// Resets and then sets everything the cell needs, which is never longer than undoing single attributes.
+void Screen::appendAttributes(attr_t attributes)
+{
+    m_out += "\x1b[0";
+    if(attributes & A_BOLD)
+        m_out += ";1";
+    if(attributes & A_DIM)
+        m_out += ";2";
+    if(attributes & A_UNDERLINE)
+        m_out += ";4";
+    if(attributes & (A_STANDOUT | A_REVERSE))
+        m_out += ";7";
+    if(const auto pair{PAIR_NUMBER(attributes)}; pair > 0)
+    {
+        short foreground{-1};
+        short background{-1};
+        pair_content(static_cast<short>(pair),&foreground,&background);
+        appendColor(m_out,foreground,30,90);
+        appendColor(m_out,background,40,100);
+    }
+    m_out += 'm';
+    m_terminalAttributes = attributes;
+    m_attributesKnown = true;
+}
+
+std::size_t Screen::present()
+{
+    if(m_renderer == Renderer::Curses)
+    {
+        wrefresh(m_window);
+        return 0;
+    }
+    PROFILE_ZONE("screen.present");
+    m_out.clear();
+    for(int y=0; y<m_rows; ++y)
+    {
+        const auto offset{static_cast<std::size_t>(y)*m_columns};
+        for(int x=0; x<m_columns; ++x)
+        {
+            const auto& cell{m_cells[offset+x]};
+            auto& shown{m_shown[offset+x]};
+            if(cell == shown)
+                continue;
+            moveTo(y,x);
+            if(!m_attributesKnown || cell.attributes != m_terminalAttributes)
+                appendAttributes(cell.attributes);
+            appendGlyph(cell.glyph);
+            shown = cell;
+            // Writing the last column leaves the cursor pending a wrap, which terminals resolve differently.
+            if(m_left+x+1 >= COLS)
+                m_cursorY = -1;
+            else
+                ++m_cursorX;
+        }
+    }
+    ++m_frames;
+    m_drawn = true;
+    const auto fd{Session::outputFd()};
+    for(std::size_t written{0}; written<m_out.size();)
+    {
+        const auto result{::write(fd,m_out.data()+written,m_out.size()-written)};
+        if(result < 0 && errno == EINTR)
+            continue;
+        if(result <= 0)
+            break;
+        written += static_cast<std::size_t>(result);
+    }
+    m_bytes += m_out.size();
+    return m_out.size();
+}
+
+void Screen::release()
+{
+    if(m_renderer != Renderer::Direct || !m_drawn)
+        return;
+    constexpr std::string_view Reset{"\x1b[0m"};
+    [[maybe_unused]] const auto written{::write(Session::outputFd(),Reset.data(),Reset.size())};
+    clearok(curscr,TRUE);
+    std::fill(m_shown.begin(),m_shown.end(),Cell{});
+    m_cursorY = -1;
+    m_attributesKnown = false;
+    m_drawn = false;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ncurses.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+Drawing surface of the animated views, in one of two renderers. Curses
+draws through an ncurses window as the other views do. Direct bypasses
+ncurses: the view draws into a grid of cells covering the window's area,
+and present() compares it with what the previous frame left on the
+terminal. Only the cells that changed are written. The cursor gets there
+by the cheapest of an absolute move, a relative move or rewriting the
+unchanged cells in between, and SGR is sent only when the attributes
+change. The whole frame goes out in one write. ncurses still owns the
+terminal modes and the input, but its picture of the screen is stale
+afterwards, so a direct Screen makes it repaint everything when it is
+destroyed or hands the area back with release().
+*/
+class Screen
+{
+public:
+    enum class Renderer{ Curses, Direct };
+
+    // Covers window's area of the terminal and starts with its attributes; through ncurses the window holds the contents.
+    Screen(WINDOW* window, Renderer renderer);
+    ~Screen();
+    Screen(const Screen&) = delete;
+    Screen& operator=(const Screen&) = delete;
+
+    // Whether the locale's character set is UTF-8, so Braille and box-drawing characters can be used.
+    static bool unicode();
+    static const char* name(Renderer renderer);
+
+    Renderer renderer() const { return m_renderer; }
+    int rows() const { return m_rows; }
+    int columns() const { return m_columns; }
+
+    // Attributes as in ncurses, COLOR_PAIR included, for the text drawn after them.
+    void attributesOn(attr_t attributes) { m_attributes |= attributes; }
+    void attributesOff(attr_t attributes) { m_attributes &= ~attributes; }
+    void setAttributes(attr_t attributes) { m_attributes = attributes; }
+
+    // UTF-8 text from (y, x), one cell per character, cut off at the right edge.
+    void text(int y, int x, std::string_view text);
+    // The ASCII character at (y, x), or 0 for anything else.
+    int at(int y, int x) const;
+    // Clears every cell, as werase.
+    void blank();
+    // Draws the border, as box.
+    void outline();
+
+    // Shows the frame; the bytes the direct renderer wrote, or 0 through ncurses.
+    std::size_t present();
+    // Lets ncurses draw over the area again; the next present() redraws every cell.
+    void release();
+    // Direct frames and the bytes they took so far.
+    std::size_t frames() const { return m_frames; }
+    std::size_t bytes() const { return m_bytes; }
+
+private:
+    struct Cell
+    {
+        std::uint32_t glyph{};
+        attr_t attributes{};
+        bool operator==(const Cell&) const = default;
+    };
+
+    void moveTo(int y, int x);
+    void appendGlyph(std::uint32_t glyph);
+    void appendAttributes(attr_t attributes);
+
+    WINDOW* m_window;
+    Renderer m_renderer;
+    int m_top{0};
+    int m_left{0};
+    int m_rows{0};
+    int m_columns{0};
+    attr_t m_attributes;
+
+    // What the view drew and what the terminal shows; a shown glyph of 0 is unknown.
+    std::vector<Cell> m_cells;
+    std::vector<Cell> m_shown;
+    std::string m_out;
+    int m_cursorY{-1};
+    int m_cursorX{-1};
+    attr_t m_terminalAttributes{A_NORMAL};
+    bool m_attributesKnown{false};
+    bool m_drawn{false};
+    std::size_t m_frames{0};
+    std::size_t m_bytes{0};
+};
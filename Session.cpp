@@ -0,0 +1,264 @@
+#include "Session.h"
+#include "FileWriter.h"
+#include "Profiler.h"
+#include "Records.h"
+#include "Utils.h"
+#include "ncurses.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr std::uint32_t Magic{0x314e5353}; // "SSN1"
+    constexpr auto FallbackTerminal{"xterm"};
+
+    struct ViewStats
+    {
+        const char* name{""};
+        Profiler::Histogram frames;
+        std::uint64_t bytes{0};
+    };
+
+    Session::Mode sessionMode{Session::Mode::Live};
+    Records::SessionHeader header;
+    std::vector<Records::Keystroke> keys;
+    std::size_t nextKey{0};
+    std::unique_ptr<FileWriter> recording;
+
+    const char* currentView{"menu"};
+    std::vector<ViewStats> views;
+    Clock::time_point started;
+    Clock::time_point frameStart;
+    bool inFrame{false};
+    double cpuStarted{0};
+
+    // The replay's terminal: a memory file whose length is the output since the last frame.
+    int screenFd{-1};
+    FILE* screenOut{nullptr};
+    FILE* screenIn{nullptr};
+    SCREEN* virtualScreen{nullptr};
+    std::uint64_t screenBytes{0};
+
+    double cpuSeconds()
+    {
+        timespec time{};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID,&time);
+        return time.tv_sec+time.tv_nsec/1e9;
+    }
+
+    ViewStats& statsOf(const char* name)
+    {
+        for(auto& stats : views)
+            if(std::strcmp(stats.name,name) == 0)
+                return stats;
+        auto& stats{views.emplace_back()};
+        stats.name = name;
+        return stats;
+    }
+
+    // Bytes written to the in-memory terminal since the last call, which are then discarded.
+    std::uint64_t takeScreenBytes()
+    {
+        if(screenFd < 0)
+            return 0;
+        std::fflush(screenOut);
+        const auto bytes{lseek(screenFd,0,SEEK_CUR)};
+        if(bytes <= 0)
+            return 0;
+        if(ftruncate(screenFd,0) == 0)
+            lseek(screenFd,0,SEEK_SET);
+        screenBytes += bytes;
+        return static_cast<std::uint64_t>(bytes);
+    }
+
+    void seed(std::uint64_t value)
+    {
+        header.seed = value;
+        Utils::seedRng(value);
+    }
+}
+
+bool Session::record(const std::string& fileName)
+{
+    recording = std::make_unique<FileWriter>(fileName);
+    if(!recording->good())
+    {
+        recording.reset();
+        return false;
+    }
+    std::random_device device;
+    seed(static_cast<std::uint64_t>(device()) << 32 | device());
+    sessionMode = Mode::Record;
+    return true;
+}
+
+bool Session::replay(const std::string& fileName)
+{
+    auto file{std::ifstream{fileName,std::ios_base::binary}};
+    const std::string data{std::istreambuf_iterator<char>{file},std::istreambuf_iterator<char>{}};
+    std::string_view in{data};
+    Records::SessionHeader loaded;
+    if(!Records::decodeBinary(in,loaded) || loaded.magic != Magic || loaded.lines < 1 || loaded.columns < 1)
+        return false;
+    std::vector<Records::Keystroke> loadedKeys;
+    loadedKeys.reserve(in.size()/Records::binaryFixedSize<Records::Keystroke>());
+    while(!in.empty())
+        if(!Records::decodeBinary(in,loadedKeys.emplace_back()))
+            return false;
+    header = std::move(loaded);
+    keys = std::move(loadedKeys);
+    seed(header.seed);
+    sessionMode = Mode::Replay;
+    return true;
+}
+
+Session::Mode Session::mode()
+{
+    return sessionMode;
+}
+
+bool Session::replaying()
+{
+    return sessionMode == Mode::Replay;
+}
+
+void Session::initScreen()
+{
+    if(sessionMode != Mode::Replay)
+    {
+        initscr();
+        header.lines = LINES;
+        header.columns = COLS;
+        header.terminal = termname();
+    }
+    else
+    {
+        screenFd = memfd_create("ratemovies-screen",0);
+        screenOut = fdopen(screenFd,"w");
+        screenIn = std::fopen("/dev/null","r");
+        virtualScreen = newterm(header.terminal.c_str(),screenOut,screenIn);
+        if(!virtualScreen)
+            virtualScreen = newterm(FallbackTerminal,screenOut,screenIn);
+        if(!virtualScreen)
+        {
+            std::cerr << "No terminal description for " << header.terminal << std::endl;
+            std::exit(1);
+        }
+        set_term(virtualScreen);
+        resizeterm(header.lines,header.columns);
+    }
+    started = Clock::now();
+    cpuStarted = cpuSeconds();
+}
+
+int Session::outputFd()
+{
+    return screenFd >= 0 ? screenFd : STDOUT_FILENO;
+}
+
+int Session::key()
+{
+    // Like getch, a replay brings the screen up to date before taking the key, and that is part of the frame.
+    if(sessionMode == Mode::Replay && is_wintouched(stdscr))
+        wrefresh(stdscr);
+    const auto now{Clock::now()};
+    if(inFrame)
+    {
+        auto& stats{statsOf(currentView)};
+        stats.frames.add(std::chrono::duration_cast<std::chrono::nanoseconds>(now-frameStart).count());
+        stats.bytes += takeScreenBytes();
+    }
+    int c{ERR};
+    if(sessionMode == Mode::Replay)
+    {
+        if(nextKey == keys.size())
+        {
+            endwin();
+            std::cerr << "The replay ran out of keys after " << keys.size() << " before the session ended" << std::endl;
+            std::exit(1);
+        }
+        c = keys[nextKey++].key;
+    }
+    else
+    {
+        c = getch();
+        if(sessionMode == Mode::Record)
+            keys.push_back({static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now()-started).count()),c});
+    }
+    inFrame = true;
+    frameStart = Clock::now();
+    return c;
+}
+
+Session::View::View(const char* name) :
+    m_parent{currentView}
+{
+    currentView = name;
+}
+
+Session::View::~View()
+{
+    currentView = m_parent;
+}
+
+bool Session::finish(std::ostream& os)
+{
+    if(sessionMode == Mode::Live)
+        return true;
+    const auto cpu{cpuSeconds()-cpuStarted};
+    const std::chrono::duration<double> wall{Clock::now()-started};
+    const auto recorded{keys.empty() ? 0.0 : keys.back().ms/1e3};
+    char line[160];
+    if(sessionMode == Mode::Record)
+    {
+        header.magic = Magic;
+        Records::encodeBinary(header,recording->buffer());
+        for(const auto& keystroke : keys)
+        {
+            Records::encodeBinary(keystroke,recording->buffer());
+            recording->flushIfFull();
+        }
+        const auto committed{recording->commit()};
+        recording.reset();
+        std::snprintf(line,sizeof(line),"Recorded %zu keys over %.1f s on a %dx%d %s terminal",
+            keys.size(),recorded,header.columns,header.lines,header.terminal.c_str());
+        os << line << '\n';
+        return committed;
+    }
+    if(virtualScreen)
+    {
+        takeScreenBytes();
+        delscreen(virtualScreen);
+        std::fclose(screenOut);
+        std::fclose(screenIn);
+        virtualScreen = nullptr;
+        screenFd = -1;
+    }
+    std::snprintf(line,sizeof(line),"Replayed %zu keys recorded over %.1f s in %.3f s, %.3f s CPU, %s to the terminal",
+        keys.size(),recorded,wall.count(),cpu,Utils::storage(screenBytes).c_str());
+    os << line << '\n';
+    std::snprintf(line,sizeof(line),"%-18s %8s %10s %10s %10s %10s %12s","VIEW","FRAMES","MEAN ms","P50 ms","P99 ms","MAX ms","BYTES/FRAME");
+    os << line << '\n';
+    for(const auto& stats : views)
+    {
+        const auto& frames{stats.frames};
+        std::snprintf(line,sizeof(line),"%-18s %8llu %10.3f %10.3f %10.3f %10.3f %12.0f",stats.name,
+            static_cast<unsigned long long>(frames.count()),frames.mean()/1e6,frames.percentile(0.5)/1e6,
+            frames.percentile(0.99)/1e6,frames.max()/1e6,frames.count() ? static_cast<double>(stats.bytes)/frames.count() : 0.0);
+        os << line << '\n';
+    }
+    os.flush();
+    return true;
+}
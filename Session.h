@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+/*
+Recorded input sessions for repeatable performance runs. Every key the
+views read goes through key(). While recording, each one is stored with
+its time since the session started, including the ERR of a timeout that
+expired, together with the random seed, the terminal size and type.
+Replaying feeds the same keys back in the same order without waiting, on
+an ncurses screen that writes into memory, so the views draw the same
+frames over the same data as fast as they can. The time between one key
+read and the next is the cost of a frame, kept per view; the report
+shows it alongside the process CPU time and the bytes sent to the
+terminal, so two builds can be compared on one session. Neither mode
+saves the catalog, comparisons, history or scores at exit, so each
+replay starts from the files the recording started from.
+*/
+namespace Session
+{
+    enum class Mode{ Live, Record, Replay };
+
+    // Seeds the random number generators and starts recording; false if the file cannot be created.
+    bool record(const std::string& fileName);
+    // Loads a recording and seeds the random number generators from it; false if it is missing or malformed.
+    bool replay(const std::string& fileName);
+    Mode mode();
+    bool replaying();
+
+    // initscr, or for a replay a screen of the recorded size and type over an in-memory terminal.
+    void initScreen();
+    // Where terminal output goes: standard output, or the in-memory terminal of a replay.
+    int outputFd();
+    // getch, recorded or replayed. A replay that runs out of keys ends the program.
+    int key();
+
+    // Attributes the frames read while it lives to name; names must outlive the program, like string literals.
+    class View
+    {
+        const char* m_parent;
+    public:
+        explicit View(const char* name);
+        ~View();
+        View(const View&) = delete;
+        View& operator=(const View&) = delete;
+    };
+
+    // Writes the recording, or prints the replay's CPU time and frame costs per view; call after endwin.
+    bool finish(std::ostream& os);
+}
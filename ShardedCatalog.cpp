@@ -0,0 +1,239 @@
+#include "ShardedCatalog.h"
+#include "FileWriter.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr auto IndexFilename{"index.bin"};
+    constexpr std::uint32_t Magic{0x4d524353}; // "SCRM"
+
+    // One bit per trigram: queries test several trigrams, so a second hash would only fill the filter faster.
+    std::size_t bloomBit(std::uint32_t trigram)
+    {
+        return (trigram*0x9E3779B97F4A7C15ull) >> (64-std::bit_width(ShardedCatalog::BloomBits-1));
+    }
+
+    // Files a previous build wrote: the index and shard-NNNNNN.bin, as named by shardPath.
+    bool isBuildOutput(const std::filesystem::path& path)
+    {
+        const auto name{path.filename().string()};
+        if(name == IndexFilename)
+            return true;
+        constexpr std::string_view Prefix{"shard-"};
+        constexpr std::string_view Suffix{".bin"};
+        if(name.size() < Prefix.size()+6+Suffix.size() || !name.starts_with(Prefix) || !name.ends_with(Suffix))
+            return false;
+        const auto digits{std::string_view{name}.substr(Prefix.size(),name.size()-Prefix.size()-Suffix.size())};
+        return std::all_of(digits.begin(),digits.end(),[](char c){ return c >= '0' && c <= '9'; });
+    }
+}
+
+std::size_t ShardedCatalog::build(std::vector<Records::Movie> movies, const std::filesystem::path& directory)
+{
+    std::filesystem::create_directories(directory);
+    for(const auto& entry : std::filesystem::directory_iterator{directory})
+        if(entry.is_regular_file() && isBuildOutput(entry.path()))
+            std::filesystem::remove(entry.path());
+
+    std::stable_sort(movies.begin(),movies.end(),[](const Records::Movie& a, const Records::Movie& b){ return a.rating > b.rating; });
+
+    std::vector<ShardIndex> index;
+    std::vector<std::uint32_t> offsets;
+    std::string body;
+    std::string record;
+    const auto flush{[&]{
+        if(offsets.empty())
+            return;
+        const auto header{sizeof(std::uint32_t)*(1+offsets.size())};
+        for(auto& offset : offsets)
+            offset += header;
+        FileWriter writer{shardPath(directory,index.size()-1).string()};
+        const auto count{static_cast<std::uint32_t>(offsets.size())};
+        writer.append({reinterpret_cast<const char*>(&count),sizeof(count)});
+        writer.append({reinterpret_cast<const char*>(offsets.data()),offsets.size()*sizeof(std::uint32_t)});
+        writer.append(body);
+        writer.commit();
+        offsets.clear();
+        body.clear();
+    }};
+
+    std::uint64_t rank{0};
+    for(const auto& movie : movies)
+    {
+        record.clear();
+        Records::encodeBinary(movie,record);
+        const auto header{sizeof(std::uint32_t)*(2+offsets.size())};
+        if(!offsets.empty() && header+body.size()+record.size() > SegmentSize)
+            flush();
+        if(offsets.empty())
+            index.push_back({rank,0,movie.rating,movie.rating});
+        auto& shard{index.back()};
+        offsets.push_back(static_cast<std::uint32_t>(body.size()));
+        body += record;
+        ++shard.count;
+        shard.ratingMin = std::min(shard.ratingMin,movie.rating);
+        shard.ratingMax = std::max(shard.ratingMax,movie.rating);
+        addTrigrams(shard.bloom,movie.name);
+        ++rank;
+    }
+    flush();
+
+    FileWriter writer{(directory/IndexFilename).string()};
+    const std::uint32_t header[]{Magic,static_cast<std::uint32_t>(sizeof(ShardIndex)),static_cast<std::uint32_t>(index.size())};
+    writer.append({reinterpret_cast<const char*>(header),sizeof(header)});
+    writer.append({reinterpret_cast<const char*>(index.data()),index.size()*sizeof(ShardIndex)});
+    writer.commit();
+    return index.size();
+}
+
+ShardedCatalog::ShardedCatalog(std::filesystem::path directory, std::size_t budgetBytes) :
+    m_directory{std::move(directory)},
+    m_budget{budgetBytes}
+{
+    auto file{std::fstream{m_directory/IndexFilename,std::ios_base::in | std::ios_base::binary}};
+    // Magic, entry size (changes with the bloom size) and shard count.
+    std::uint32_t header[3]{};
+    if(!file.read(reinterpret_cast<char*>(header),sizeof(header)) || header[0] != Magic || header[1] != sizeof(ShardIndex))
+        return;
+    m_index.resize(header[2]);
+    if(!file.read(reinterpret_cast<char*>(m_index.data()),m_index.size()*sizeof(ShardIndex)))
+    {
+        m_index.clear();
+        return;
+    }
+    m_mappings.resize(m_index.size());
+    if(!m_index.empty())
+        m_size = m_index.back().firstRank+m_index.back().count;
+}
+
+ShardedCatalog::~ShardedCatalog()
+{
+    for(auto& mapping : m_mappings)
+        unmap(mapping);
+}
+
+std::size_t ShardedCatalog::shardOf(std::size_t rank) const
+{
+    const auto it{std::upper_bound(m_index.begin(),m_index.end(),rank,[](std::size_t rank, const ShardIndex& shard){ return rank < shard.firstRank; })};
+    return it == m_index.begin() ? 0 : static_cast<std::size_t>(it-m_index.begin()-1);
+}
+
+std::string_view ShardedCatalog::map(std::size_t shard)
+{
+    auto& mapping{m_mappings[shard]};
+    mapping.lastUse = ++m_clock;
+    if(mapping.data)
+    {
+        ++m_stats.hits;
+        return {mapping.data,mapping.size};
+    }
+    ++m_stats.misses;
+
+    const auto fd{::open(shardPath(m_directory,shard).c_str(),O_RDONLY | O_CLOEXEC)};
+    if(fd < 0)
+        return {};
+    struct stat info{};
+    void* data{MAP_FAILED};
+    if(::fstat(fd,&info) == 0 && info.st_size > 0)
+        data = ::mmap(nullptr,info.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    ::close(fd);
+    if(data == MAP_FAILED)
+        return {};
+
+    // Evict least recently used shards until the new one fits; it is always kept even if larger than the budget.
+    while(m_stats.mappedShards > 0 && m_stats.mappedBytes+info.st_size > m_budget)
+    {
+        auto oldest{m_mappings.end()};
+        for(auto it{m_mappings.begin()}; it!=m_mappings.end(); ++it)
+            if(it->data && (oldest == m_mappings.end() || it->lastUse < oldest->lastUse))
+                oldest = it;
+        unmap(*oldest);
+        ++m_stats.evictions;
+    }
+
+    mapping.data = static_cast<const char*>(data);
+    mapping.size = info.st_size;
+    ++m_stats.mappedShards;
+    m_stats.mappedBytes += mapping.size;
+    return {mapping.data,mapping.size};
+}
+
+void ShardedCatalog::unmap(Mapping& mapping)
+{
+    if(!mapping.data)
+        return;
+    ::munmap(const_cast<char*>(mapping.data),mapping.size);
+    --m_stats.mappedShards;
+    m_stats.mappedBytes -= mapping.size;
+    mapping.data = nullptr;
+    mapping.size = 0;
+}
+
+bool ShardedCatalog::decodeRow(std::string_view data, std::uint32_t row, Records::Movie& movie)
+{
+    std::uint32_t count;
+    if(data.size() < sizeof(count))
+        return false;
+    std::memcpy(&count,data.data(),sizeof(count));
+    if(row >= count || data.size() < sizeof(count)*(2+row))
+        return false;
+    std::uint32_t offset;
+    std::memcpy(&offset,data.data()+sizeof(count)*(1+row),sizeof(offset));
+    if(offset > data.size())
+        return false;
+    auto record{data.substr(offset)};
+    return Records::decodeBinary(record,movie);
+}
+
+void ShardedCatalog::toLower(std::string& text)
+{
+    for(auto& c : text)
+        if(c >= 'A' && c <= 'Z')
+            c += 'a'-'A';
+}
+
+std::vector<std::uint32_t> ShardedCatalog::trigramsOf(std::string_view text)
+{
+    std::string lowered{text};
+    toLower(lowered);
+    std::vector<std::uint32_t> trigrams;
+    for(std::size_t i=0; i+3<=lowered.size(); ++i)
+        trigrams.push_back(static_cast<std::uint8_t>(lowered[i]) << 16 | static_cast<std::uint8_t>(lowered[i+1]) << 8 | static_cast<std::uint8_t>(lowered[i+2]));
+    return trigrams;
+}
+
+void ShardedCatalog::addTrigrams(Bloom& bloom, std::string_view title)
+{
+    for(const auto trigram : trigramsOf(title))
+    {
+        const auto bit{bloomBit(trigram)};
+        bloom[bit/64] |= std::uint64_t{1} << (bit%64);
+    }
+}
+
+bool ShardedCatalog::mayContain(const ShardIndex& index, const std::vector<std::uint32_t>& trigrams)
+{
+    for(const auto trigram : trigrams)
+    {
+        const auto bit{bloomBit(trigram)};
+        if(!(index.bloom[bit/64] & std::uint64_t{1} << (bit%64)))
+            return false;
+    }
+    return true;
+}
+
+std::filesystem::path ShardedCatalog::shardPath(const std::filesystem::path& directory, std::size_t shard)
+{
+    char name[32];
+    std::snprintf(name,sizeof(name),"shard-%06zu.bin",shard);
+    return directory/name;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Records.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+Read-only catalog stored as fixed-size segment files that are mmapped on
+demand. Rows are ordered by rating, highest first, so a row's rank also
+names its shard. A small index kept in memory holds each shard's rating
+range and a bloom filter of its title trigrams; searches and top-N
+queries use it to skip shards they cannot match, and mapped shards are
+evicted least recently used once the page budget is exceeded.
+*/
+class ShardedCatalog
+{
+public:
+    static constexpr std::size_t SegmentSize{64*1024};
+    static constexpr std::size_t BloomBits{16384};
+
+    struct Stats
+    {
+        std::uint64_t hits{0};
+        std::uint64_t misses{0};
+        std::uint64_t evictions{0};
+        std::size_t mappedShards{0};
+        std::size_t mappedBytes{0};
+    };
+
+    // Writes movies into directory as shard files plus an index, replacing a previous build (other files are left alone); returns the shard count.
+    static std::size_t build(std::vector<Records::Movie> movies, const std::filesystem::path& directory);
+
+    ShardedCatalog(std::filesystem::path directory, std::size_t budgetBytes);
+    ~ShardedCatalog();
+    ShardedCatalog(const ShardedCatalog&) = delete;
+    ShardedCatalog& operator=(const ShardedCatalog&) = delete;
+
+    bool good() const { return !m_index.empty(); }
+    std::size_t size() const { return m_size; }
+    std::size_t shards() const { return m_index.size(); }
+    std::size_t budget() const { return m_budget; }
+    const Stats& stats() const { return m_stats; }
+
+    // fcn(rank, movie) for the rows ranked [first, first+count).
+    template<class F>
+    void forEachInRange(std::size_t first, std::size_t count, F&& fcn)
+    {
+        const auto last{std::min(first+count,m_size)};
+        Records::Movie movie;
+        for(auto shard{shardOf(first)}; shard<m_index.size() && m_index[shard].firstRank<last; ++shard)
+        {
+            const auto& index{m_index[shard]};
+            const auto from{first > index.firstRank ? first-index.firstRank : 0};
+            const auto to{std::min<std::uint64_t>(index.count,last-index.firstRank)};
+            const auto data{map(shard)};
+            for(auto row{from}; row<to; ++row)
+                if(decodeRow(data,row,movie))
+                    fcn(index.firstRank+row,movie);
+        }
+    }
+
+    // fcn(rank, movie) for every row whose title contains query, ignoring ASCII case.
+    template<class F>
+    void search(std::string_view query, F&& fcn)
+    {
+        const auto trigrams{trigramsOf(query)};
+        std::string needle{query};
+        toLower(needle);
+        std::string lowered;
+        Records::Movie movie;
+        for(std::size_t shard=0; shard<m_index.size(); ++shard)
+        {
+            if(!mayContain(m_index[shard],trigrams))
+                continue;
+            const auto data{map(shard)};
+            for(std::uint32_t row=0; row<m_index[shard].count; ++row)
+            {
+                if(!decodeRow(data,row,movie))
+                    continue;
+                lowered.assign(movie.name);
+                toLower(lowered);
+                if(lowered.find(needle) != std::string::npos)
+                    fcn(m_index[shard].firstRank+row,movie);
+            }
+        }
+    }
+
+    // Visits shards from the highest rated down while wanted(highest rating in the shard) holds; fcn(rank, movie) per row.
+    template<class W, class F>
+    void forEachWhile(W&& wanted, F&& fcn)
+    {
+        Records::Movie movie;
+        for(std::size_t shard=0; shard<m_index.size() && wanted(m_index[shard].ratingMax); ++shard)
+        {
+            const auto data{map(shard)};
+            for(std::uint32_t row=0; row<m_index[shard].count; ++row)
+                if(decodeRow(data,row,movie))
+                    fcn(m_index[shard].firstRank+row,movie);
+        }
+    }
+
+private:
+    using Bloom = std::array<std::uint64_t,BloomBits/64>;
+
+    struct ShardIndex
+    {
+        std::uint64_t firstRank{0};
+        std::uint32_t count{0};
+        double ratingMin{0};
+        double ratingMax{0};
+        Bloom bloom{};
+    };
+
+    struct Mapping
+    {
+        const char* data{nullptr};
+        std::size_t size{0};
+        std::uint64_t lastUse{0};
+    };
+
+    static void toLower(std::string& text);
+    static std::vector<std::uint32_t> trigramsOf(std::string_view text);
+    static void addTrigrams(Bloom& bloom, std::string_view title);
+    static bool mayContain(const ShardIndex& index, const std::vector<std::uint32_t>& trigrams);
+    static bool decodeRow(std::string_view data, std::uint32_t row, Records::Movie& movie);
+    static std::filesystem::path shardPath(const std::filesystem::path& directory, std::size_t shard);
+
+    std::size_t shardOf(std::size_t rank) const;
+    // Shard contents; valid until the next call, which may evict it.
+    std::string_view map(std::size_t shard);
+    void unmap(Mapping& mapping);
+
+    std::filesystem::path m_directory;
+    std::size_t m_budget;
+    std::size_t m_size{0};
+    std::vector<ShardIndex> m_index;
+    std::vector<Mapping> m_mappings;
+    std::uint64_t m_clock{0};
+    Stats m_stats;
+};
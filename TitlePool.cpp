@@ -0,0 +1,65 @@
+#include "TitlePool.h"
+#include <cstring>
+#include <functional>
+
+namespace
+{
+    constexpr std::size_t MaxLengthBytes{3};
+
+    std::size_t hashOf(std::string_view title) { return std::hash<std::string_view>{}(title); }
+}
+
+TitlePool::Handle TitlePool::intern(std::string_view title)
+{
+    title = title.substr(0,PageSize-MaxLengthBytes);
+    if((m_count+1)*2 > m_table.size())
+        grow();
+    const auto mask{m_table.size()-1};
+    for(auto slot{hashOf(title) & mask};; slot = (slot+1) & mask)
+    {
+        if(m_table[slot] == Empty)
+        {
+            m_table[slot] = append(title);
+            ++m_count;
+            return m_table[slot];
+        }
+        if((*this)[m_table[slot]] == title)
+            return m_table[slot];
+    }
+}
+
+TitlePool::Handle TitlePool::append(std::string_view title)
+{
+    if(m_used+MaxLengthBytes+title.size() > PageSize)
+    {
+        m_pages.push_back(std::make_unique_for_overwrite<char[]>(PageSize));
+        m_used = 0;
+    }
+    const auto handle{static_cast<Handle>((m_pages.size()-1)*PageSize+m_used)};
+    auto pos{m_pages.back().get()+m_used};
+    auto length{title.size()};
+    do
+    {
+        *pos++ = static_cast<char>((length & 0x7f) | (length > 0x7f ? 0x80 : 0));
+        length >>= 7;
+    } while(length);
+    std::memcpy(pos,title.data(),title.size());
+    m_used = pos+title.size()-m_pages.back().get();
+    return handle;
+}
+
+void TitlePool::grow()
+{
+    std::vector<Handle> table(std::max<std::size_t>(m_table.size()*2,1024),Empty);
+    const auto mask{table.size()-1};
+    for(const auto handle : m_table)
+    {
+        if(handle == Empty)
+            continue;
+        auto slot{hashOf((*this)[handle]) & mask};
+        while(table[slot] != Empty)
+            slot = (slot+1) & mask;
+        table[slot] = handle;
+    }
+    m_table = std::move(table);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/*
+Interned movie titles. Each distinct title is stored once, as a varint
+length followed by its bytes, in large fixed-size pages that never move,
+so a title is a 32-bit handle and the views handed out stay valid for
+the life of the pool. A hash table of handles finds an existing copy
+before a new one is appended.
+*/
+class TitlePool
+{
+public:
+    using Handle = std::uint32_t;
+    static constexpr std::size_t PageSize{1 << 20};
+
+    TitlePool() = default;
+    TitlePool(const TitlePool&) = delete;
+    TitlePool& operator=(const TitlePool&) = delete;
+
+    // Handle of the stored copy of title, adding it if unseen. Titles longer than a page are truncated.
+    Handle intern(std::string_view title);
+
+    std::string_view operator[](Handle handle) const
+    {
+        auto pos{reinterpret_cast<const unsigned char*>(m_pages[handle/PageSize].get())+handle%PageSize};
+        std::size_t length{0};
+        for(auto shift{0};; shift += 7)
+        {
+            const auto byte{*pos++};
+            length |= static_cast<std::size_t>(byte & 0x7f) << shift;
+            if(byte < 0x80)
+                break;
+        }
+        return {reinterpret_cast<const char*>(pos),length};
+    }
+
+    // Distinct titles stored.
+    std::size_t size() const { return m_count; }
+    // Heap bytes held by the pages and the hash table.
+    std::size_t bytes() const { return m_pages.size()*PageSize+m_table.capacity()*sizeof(Handle); }
+private:
+    static constexpr Handle Empty{~Handle{0}};
+
+    std::vector<std::unique_ptr<char[]>> m_pages;
+    std::size_t m_used{PageSize};
+    std::vector<Handle> m_table;
+    std::size_t m_count{0};
+
+    Handle append(std::string_view title);
+    void grow();
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "List.h"
+#include <algorithm>
+
+/*
+Linked list of cache-line sized blocks, each holding several values.
+Traversal touches one line per block instead of one per value; removing
+shifts the rest of its block and unlinks the block once it is empty.
+Same interface as List<T>.
+*/
+template<class T>
+class UnrolledList
+{
+    static constexpr std::size_t CacheLine{64};
+
+    struct Header
+    {
+        void* next;
+        std::size_t count;
+    };
+
+public:
+    static constexpr std::size_t Capacity{std::max<std::size_t>(1,(CacheLine-sizeof(Header))/sizeof(T))};
+
+private:
+    struct alignas(CacheLine) Block
+    {
+        Block* next{nullptr};
+        std::size_t count{0};
+        T values[Capacity]{};
+    };
+
+    std::size_t m_allocated{0};
+    std::size_t m_freed{0};
+    std::size_t m_size{0};
+
+    NodePool<Block> m_pool;
+    Block* m_head{nullptr};
+    Block* m_tail{nullptr};
+public:
+    UnrolledList(const T& rootValue)
+    {
+        append(rootValue);
+    }
+    ~UnrolledList()
+    {
+        clear();
+    }
+    UnrolledList(const UnrolledList&) = delete;
+    UnrolledList& operator=(const UnrolledList&) = delete;
+
+    void append(const T& value)
+    {
+        if(!m_tail || m_tail->count == Capacity)
+        {
+            auto block{m_pool.create()};
+            m_allocated+=sizeof(Block);
+            if(m_tail)
+                m_tail->next = block;
+            else
+                m_head = block;
+            m_tail = block;
+        }
+        m_tail->values[m_tail->count++] = value;
+        ++m_size;
+    }
+
+    bool remove(int n)
+    {
+        if(n<0 || n>=m_size)
+            return false;
+        auto block{m_head};
+        Block* prev{nullptr};
+        std::size_t index(n);
+        while(index >= block->count)
+        {
+            index -= block->count;
+            prev = block;
+            block = block->next;
+        }
+        std::move(block->values+index+1,block->values+block->count,block->values+index);
+        --block->count;
+        --m_size;
+
+        if(block->count == 0)
+        {
+            if(prev)
+                prev->next = block->next;
+            else
+                m_head = block->next;
+            if(block == m_tail)
+                m_tail = prev;
+            release(block);
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        auto block{m_head};
+        while(block)
+        {
+            auto toDelete{block};
+            block = block->next;
+            m_size -= toDelete->count;
+            release(toDelete);
+        }
+        m_head = nullptr;
+        m_tail = nullptr;
+    }
+
+    std::size_t size() const { return m_size; }
+
+    template<class F>
+    void forEach(F&& fcn) const
+    {
+        for(auto block{m_head}; block; block = block->next)
+            for(std::size_t i=0; i<block->count; ++i)
+                fcn(block->values[i]);
+    }
+
+    void print(std::ostream& os) const
+    {
+        constexpr auto Bar{"+------------------------------+"};
+        os << Bar <<std::endl;
+        os <<memoryUsage(m_allocated,m_freed,m_pool.reserved())<< "UNROLLED\tSize: "<<m_size<<", Type: "<<Utils::typeName(T{})<<", Per block: "<<Capacity<<std::endl;
+        int count{0};
+        for(auto block{m_head}; block; block = block->next)
+        {
+            const std::string ind(count,' ');
+            if(block != m_head)
+                os << "\n" <<ind<<"|\n"<<ind << "+->";
+            os << (block==m_head ? "Head" : !block->next ? "Tail" : "Block"+std::to_string(count)) << "[";
+            for(std::size_t i=0; i<block->count; ++i)
+                os << (i ? ", " : "") << block->values[i];
+            os << "]";
+            ++count;
+        }
+        os << std::endl;
+        os << Bar <<std::endl;
+    }
+private:
+    void release(Block* block)
+    {
+        m_freed+=sizeof(Block);
+        m_pool.destroy(block);
+    }
+};
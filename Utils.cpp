@@ -1,5 +1,7 @@
 #include "Utils.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <random>
 #include <sstream>
 #include <chrono>
@@ -11,7 +13,7 @@ namespace
     constexpr auto Gb{Kb*Mb};
 }
 
-auto getYear()
+int Utils::currentYear()
 {
     const std::chrono::time_point now{std::chrono::system_clock::now()};
     const std::chrono::year_month_day ymd{std::chrono::floor<std::chrono::days>(now)};
@@ -20,7 +22,7 @@ auto getYear()
 
 bool Utils::validYear(int year)
 { 
-    return year > 1900 && year <= getYear();
+    return year > 1900 && year <= currentYear();
 }
 
 bool Utils::validAscii(char c) 
@@ -43,12 +45,25 @@ std::pair<double,double> Utils::computeElo(double Ra, double Rb, bool victor)
     return { Ra_, Rb_ };
 }
 
+namespace
+{
+    std::mt19937& engine()
+    {
+        thread_local std::mt19937 engine{std::random_device{}()};
+        return engine;
+    }
+}
+
+void Utils::seedRng(std::uint64_t seed)
+{
+    engine().seed(static_cast<std::mt19937::result_type>(seed ^ seed >> 32));
+    std::srand(static_cast<unsigned>(seed));
+}
+
 int Utils::rng(int min, int max) 
 {
-    std::random_device  dev;
-    std::mt19937        rng(dev());
-    std::uniform_int_distribution<std::mt19937::result_type> dist6(min,max);
-    return dist6(rng);
+    std::uniform_int_distribution<int> dist(min,max);
+    return dist(engine());
 }
 
 bool Utils::stringEquals(std::string a, std::string b)
@@ -77,21 +92,35 @@ int Utils::wrapAround(int val, int min, int max)
     return val < min ? max : val > max ? min : val;
 }
 
-std::vector<std::string> Utils::tokenize(const std::string& str, char delimiter)
-{    
-    std::vector<std::string> tokens;
-    std::string token;
-    std::stringstream ss{str};
-    while(std::getline(ss,token,delimiter))
-        tokens.push_back(token);
-    return tokens;
+void Utils::appendCsvField(std::string& out, std::string_view field, char delimiter)
+{
+    const char special[]{delimiter,'"','\n','\r'};
+    if(field.find_first_of(std::string_view{special,sizeof(special)}) == std::string_view::npos)
+    {
+        out += field;
+        return;
+    }
+    const auto quoted{field.find_first_of(std::string_view{special,2}) != std::string_view::npos};
+    if(quoted)
+        out += '"';
+    for(const auto c : field)
+    {
+        if(c == '"')
+            out += '"';
+        out += (c == '\n' || c == '\r') ? ' ' : c;
+    }
+    if(quoted)
+        out += '"';
 }
 
 std::string Utils::timeStamp()
 {
     auto end = std::chrono::system_clock::now();
     std::time_t end_time = std::chrono::system_clock::to_time_t(end);
-    return std::ctime(&end_time);
+    std::string str{std::ctime(&end_time)};
+    if(!str.empty() && str.back() == '\n')
+        str.pop_back();
+    return str;
 }
 
 std::string Utils::storage(std::size_t bytes)
@@ -109,12 +138,12 @@ std::string Utils::storage(std::size_t bytes)
 }
 
 Utils::Timer::Timer() : 
-    timeStart{std::chrono::high_resolution_clock::now()}
+    timeStart{std::chrono::steady_clock::now()}
 {}
 
 std::string Utils::Timer::get()
 {
-    const std::chrono::duration<double,std::milli> duration{(std::chrono::high_resolution_clock::now() - timeStart)};
+    const std::chrono::duration<double,std::milli> duration{(std::chrono::steady_clock::now() - timeStart)};
     const auto count{duration.count()};
 
     return std::to_string(count).substr(0,4) + "ms";
@@ -1,4 +1,16 @@
 #include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <typeinfo>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string_view>
 
 #pragma once
 
@@ -16,13 +28,18 @@ namespace Utils
 
     int wrapAround(int val, int min, int max);
     int rng(int min, int max);
+    // Makes rng and std::rand repeat the same sequence on this thread; otherwise rng starts from a random seed.
+    void seedRng(std::uint64_t seed);
+    int currentYear();
     bool validYear(int year);
     bool validAscii(char c);
     bool backspace(char c);
     bool stringEquals(std::string a, std::string b);
     std::pair<double,double> computeElo(double Ra, double Rb, bool victor);
     std::pair<int,int> getTwoRngs(int min, int max);
-    std::vector<std::string> tokenize(const std::string& str, char delimiter = ',');
+    // Field as written to a CSV line: quoted, with quotes doubled, when it contains the delimiter or a quote.
+    // Records are one line each, so line breaks are written as spaces.
+    void appendCsvField(std::string& out, std::string_view field, char delimiter = ',');
     std::string timeStamp();
     std::string storage(std::size_t bytes);
 
@@ -44,26 +61,244 @@ namespace Utils
         return rawName;
     }
 
+    // Lazy split on a single character. Tokens are views into the original text, so the text must outlive them.
+    class Split
+    {
+    public:
+        class Iterator
+        {
+            const char* m_next{nullptr};
+            const char* m_end{nullptr};
+            std::string_view m_token;
+            char m_delimiter{};
+            bool m_done{true};
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const std::string_view*;
+            using reference = const std::string_view&;
+
+            Iterator() = default;
+            Iterator(std::string_view text, char delimiter) :
+                m_next{text.data()},
+                m_end{text.data()+text.size()},
+                m_delimiter{delimiter},
+                m_done{false}
+            {
+                ++*this;
+            }
+            const std::string_view& operator*() const { return m_token; }
+            Iterator& operator++()
+            {
+                if(m_next == nullptr)
+                {
+                    m_done = true;
+                    return *this;
+                }
+                const auto found{static_cast<const char*>(std::memchr(m_next,m_delimiter,m_end-m_next))};
+                const auto stop{found ? found : m_end};
+                m_token = {m_next,static_cast<std::size_t>(stop-m_next)};
+                m_next = found ? found+1 : nullptr;
+                return *this;
+            }
+            bool operator==(const Iterator& other) const { return m_done == other.m_done && (m_done || m_token.data() == other.m_token.data()); }
+            bool operator!=(const Iterator& other) const { return !(*this == other); }
+        };
+
+        // Like getline, a trailing delimiter does not produce an empty last token.
+        Split(std::string_view text, char delimiter = ',') :
+            m_text{text.empty() || text.back() != delimiter ? text : text.substr(0,text.size()-1)},
+            m_delimiter{delimiter},
+            m_empty{text.empty()} {}
+        Iterator begin() const { return m_empty ? Iterator{} : Iterator{m_text,m_delimiter}; }
+        Iterator end() const { return {}; }
+    private:
+        std::string_view m_text;
+        char m_delimiter;
+        bool m_empty;
+    };
+
+    /*
+    Field scanner for one CSV line. Quoted fields may contain the delimiter and
+    doubled quotes; quotes are removed in place, so every field is a view into
+    the line and scanning never allocates.
+    */
+    class CsvScanner
+    {
+    public:
+        CsvScanner(std::string& line, char delimiter = ',') :
+            m_pos{line.data()},
+            m_end{line.data()+line.size()},
+            m_delimiter{delimiter} {}
+
+        // Next field, or nothing once the line is exhausted.
+        std::optional<std::string_view> next()
+        {
+            if(m_pos == nullptr)
+                return std::nullopt;
+            const auto start{m_pos};
+            if(m_pos == m_end || *m_pos != '"')
+            {
+                const auto found{static_cast<char*>(std::memchr(m_pos,m_delimiter,m_end-m_pos))};
+                const auto stop{found ? found : m_end};
+                m_pos = found ? found+1 : nullptr;
+                return std::string_view{start,static_cast<std::size_t>(stop-start)};
+            }
+            auto out{start};
+            auto in{start+1};
+            while(in < m_end)
+            {
+                const auto quote{static_cast<char*>(std::memchr(in,'"',m_end-in))};
+                const auto stop{quote ? quote : m_end};
+                std::memmove(out,in,stop-in);
+                out += stop-in;
+                if(quote && quote+1 < m_end && quote[1] == '"')
+                {
+                    *out++ = '"';
+                    in = quote+2;
+                    continue;
+                }
+                in = quote ? quote+1 : m_end;
+                break;
+            }
+            const auto found{static_cast<char*>(std::memchr(in,m_delimiter,m_end-in))};
+            m_pos = found ? found+1 : nullptr;
+            return std::string_view{start,static_cast<std::size_t>(out-start)};
+        }
+    private:
+        char* m_pos;
+        char* m_end;
+        char m_delimiter;
+    };
+
+    // Window over the last `size` added elements, oldest first. Backed by a ring buffer, so adding never moves elements.
     template<class T>
     class Queue
     {
     public:
-        Queue(std::size_t size) : m_size{size} {}
+        class Iterator
+        {
+            const Queue* m_queue;
+            std::size_t m_index;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            Iterator(const Queue* queue, std::size_t index) : m_queue{queue}, m_index{index} {}
+            const T& operator*() const { return m_queue->buf[(m_queue->m_start+m_index)%m_queue->m_size]; }
+            Iterator& operator++() { ++m_index; return *this; }
+            bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+            bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+        };
+
+        Queue(std::size_t size) : buf(size), m_size{size} {}
         void add(T element)
         {
-            buf.push_back(element);
-            if(buf.size()>m_size)
-                buf.erase(buf.begin());
+            if(m_size == 0)
+                return;
+            buf[(m_start+m_count)%m_size] = std::move(element);
+            if(m_count < m_size)
+                ++m_count;
+            else
+                m_start = (m_start+1)%m_size;
         }
-        T get(int i) {
-            return i<m_size ? buf[i] : T{};
+        T get(std::size_t i) const {
+            return i<m_count ? buf[(m_start+i)%m_size] : T{};
         }
-        auto begin() { return buf.begin(); }
-        auto end() { return buf.end(); }
-        auto get() { return buf; }
-        auto size() { return m_size; }
+        Iterator begin() const { return {this,0}; }
+        Iterator end() const { return {this,m_count}; }
+        std::size_t size() const { return m_count; }
+        std::size_t capacity() const { return m_size; }
     private:
         std::vector<T> buf;
         std::size_t m_size{0};
+        std::size_t m_start{0};
+        std::size_t m_count{0};
+    };
+    /*
+    Queue fed by any number of producer threads and read by one consumer. add()
+    is lock-free: each cell of a bounded ring carries a sequence number telling
+    producers and the consumer whose turn it is, so neither side ever blocks,
+    and add fails instead when the consumer is a whole ring behind. The
+    consumer calls update() to move what arrived into a Queue of the same size;
+    get, iteration and size then read that window, oldest first, as on Queue.
+    */
+    template<class T>
+    class ConcurrentQueue
+    {
+    public:
+        using Iterator = typename Queue<T>::Iterator;
+
+        ConcurrentQueue(std::size_t size) :
+            m_window{size},
+            m_mask{std::bit_ceil(std::max<std::size_t>(size,2))-1},
+            m_cells{std::make_unique<Cell[]>(m_mask+1)}
+        {
+            for(std::size_t i=0; i<=m_mask; ++i)
+                m_cells[i].sequence.store(i,std::memory_order_relaxed);
+        }
+
+        // Any thread.
+        bool add(T element)
+        {
+            auto pos{m_tail.load(std::memory_order_relaxed)};
+            while(true)
+            {
+                auto& cell{m_cells[pos & m_mask]};
+                const auto sequence{cell.sequence.load(std::memory_order_acquire)};
+                const auto diff{static_cast<std::ptrdiff_t>(sequence)-static_cast<std::ptrdiff_t>(pos)};
+                if(diff == 0)
+                {
+                    if(m_tail.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+                    {
+                        cell.value = std::move(element);
+                        cell.sequence.store(pos+1,std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if(diff < 0)
+                    return false;
+                else
+                    pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        // Consumer thread only, as is everything below; returns how many elements arrived.
+        std::size_t update()
+        {
+            std::size_t count{0};
+            for(auto pos{m_head};; ++pos, ++count)
+            {
+                auto& cell{m_cells[pos & m_mask]};
+                if(cell.sequence.load(std::memory_order_acquire) != pos+1)
+                {
+                    m_head = pos;
+                    return count;
+                }
+                m_window.add(std::move(cell.value));
+                cell.sequence.store(pos+m_mask+1,std::memory_order_release);
+            }
+        }
+
+        T get(std::size_t i) const { return m_window.get(i); }
+        Iterator begin() const { return m_window.begin(); }
+        Iterator end() const { return m_window.end(); }
+        std::size_t size() const { return m_window.size(); }
+        std::size_t capacity() const { return m_window.capacity(); }
+    private:
+        struct Cell
+        {
+            std::atomic<std::size_t> sequence;
+            T value{};
+        };
+        Queue<T> m_window;
+        const std::size_t m_mask;
+        std::unique_ptr<Cell[]> m_cells;
+        alignas(64) std::atomic<std::size_t> m_tail{0};
+        alignas(64) std::size_t m_head{0};
     };
 }
\ No newline at end of file
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Ranking.h"
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <vector>
+
+/*
+Secondary index by release year. Each year keeps its movie ids sorted
+the way Ranking sorts the whole catalog (rating descending, then id),
+so a rating range is a slice of every year and a year-and-rating filter
+is answered by merging those slices lazily; nothing is copied and rows
+are produced only as far as the caller reads.
+*/
+class YearIndex
+{
+public:
+    static constexpr int FirstYear{1901};
+
+    struct Filter
+    {
+        int fromYear{FirstYear};
+        int toYear{std::numeric_limits<int>::max()};
+        double minRating{-std::numeric_limits<double>::infinity()};
+        double maxRating{std::numeric_limits<double>::infinity()};
+    };
+
+    // Streams the ids matching a filter in ranking order.
+    template<class Rating>
+    class Cursor
+    {
+        struct Head
+        {
+            const MovieId* pos;
+            const MovieId* end;
+        };
+        Rating m_rating;
+        std::vector<Head> m_heads;
+
+        // Heap order: the head that ranks first is at the front.
+        auto later() const { return [this](const Head& a, const Head& b){ return before(*b.pos,*a.pos,m_rating); }; }
+    public:
+        Cursor(const Rating& rating, std::vector<Head> heads) : m_rating{rating}, m_heads{std::move(heads)}
+        {
+            std::make_heap(m_heads.begin(),m_heads.end(),later());
+        }
+
+        bool next(MovieId& id)
+        {
+            if(m_heads.empty())
+                return false;
+            std::pop_heap(m_heads.begin(),m_heads.end(),later());
+            auto& head{m_heads.back()};
+            id = *head.pos++;
+            if(head.pos == head.end)
+                m_heads.pop_back();
+            else
+                std::push_heap(m_heads.begin(),m_heads.end(),later());
+            return true;
+        }
+
+        void skip(std::size_t count)
+        {
+            MovieId id;
+            while(count-- > 0 && next(id)) {}
+        }
+
+        friend class YearIndex;
+    };
+
+    // year(id) returns a movie's release year, rating(id) its rating.
+    template<class Year, class Rating>
+    void rebuild(std::size_t count, const Year& year, const Rating& rating)
+    {
+        m_buckets.clear();
+        m_year.clear();
+        insert(0,static_cast<MovieId>(count),year,rating);
+    }
+
+    // Adds the new ids [first,last): each year sorts its newcomers and merges them in.
+    template<class Year, class Rating>
+    void insert(MovieId first, MovieId last, const Year& year, const Rating& rating)
+    {
+        m_year.resize(std::max<std::size_t>(m_year.size(),last));
+        std::vector<std::size_t> sizes(m_buckets.size());
+        for(std::size_t b=0; b<m_buckets.size(); ++b)
+            sizes[b] = m_buckets[b].size();
+        for(auto id{first}; id<last; ++id)
+        {
+            const auto b{bucket(year(id))};
+            if(b >= m_buckets.size())
+            {
+                m_buckets.resize(b+1);
+                sizes.resize(b+1,0);
+            }
+            m_year[id] = year(id);
+            m_buckets[b].push_back(id);
+        }
+        const auto order{[&rating](MovieId a, MovieId b){ return before(a,b,rating); }};
+        for(std::size_t b=0; b<m_buckets.size(); ++b)
+        {
+            auto& ids{m_buckets[b]};
+            if(ids.size() == sizes[b])
+                continue;
+            const auto middle{ids.begin()+sizes[b]};
+            std::sort(middle,ids.end(),order);
+            std::inplace_merge(ids.begin(),middle,ids.end(),order);
+        }
+    }
+
+    // Moves one id after its rating changed from oldRating.
+    template<class Rating>
+    void update(MovieId id, double oldRating, const Rating& rating)
+    {
+        auto& ids{m_buckets[bucket(m_year[id])]};
+        const auto old{[&](MovieId other){ return other == id ? oldRating : rating(other); }};
+        const auto pos{std::lower_bound(ids.begin(),ids.end(),id,[&old](MovieId a, MovieId b){ return before(a,b,old); })};
+        ids.erase(pos);
+        ids.insert(std::lower_bound(ids.begin(),ids.end(),id,[&rating](MovieId a, MovieId b){ return before(a,b,rating); }),id);
+    }
+
+    // Re-sorts only the years holding one of the changed ids.
+    template<class Rating>
+    void update(const std::vector<MovieId>& ids, const Rating& rating)
+    {
+        std::vector<bool> touched(m_buckets.size());
+        for(const auto id : ids)
+            touched[bucket(m_year[id])] = true;
+        for(std::size_t b=0; b<m_buckets.size(); ++b)
+            if(touched[b])
+                std::sort(m_buckets[b].begin(),m_buckets[b].end(),[&rating](MovieId x, MovieId y){ return before(x,y,rating); });
+    }
+
+    // Re-sorts every year after many ratings changed at once.
+    template<class Rating>
+    void refresh(const Rating& rating)
+    {
+        for(auto& ids : m_buckets)
+            std::sort(ids.begin(),ids.end(),[&rating](MovieId a, MovieId b){ return before(a,b,rating); });
+    }
+
+    // The rating slice of every year in the filter's range.
+    template<class Rating>
+    Cursor<Rating> query(const Filter& filter, const Rating& rating) const
+    {
+        std::vector<typename Cursor<Rating>::Head> heads;
+        forEachSlice(filter,rating,[&heads](const MovieId* first, const MovieId* last){ heads.push_back({first,last}); });
+        return {rating,std::move(heads)};
+    }
+
+    // Number of matches, from two binary searches per year.
+    template<class Rating>
+    std::size_t count(const Filter& filter, const Rating& rating) const
+    {
+        std::size_t total{0};
+        forEachSlice(filter,rating,[&total](const MovieId* first, const MovieId* last){ total += last-first; });
+        return total;
+    }
+
+private:
+    std::vector<std::vector<MovieId>> m_buckets;
+    std::vector<int> m_year;
+
+    static std::size_t bucket(int year) { return static_cast<std::size_t>(std::max(year,FirstYear)-FirstYear); }
+
+    template<class Rating>
+    static bool before(MovieId a, MovieId b, const Rating& rating)
+    {
+        const auto ra{rating(a)};
+        const auto rb{rating(b)};
+        return ra > rb || (ra == rb && a < b);
+    }
+
+    template<class Rating, class F>
+    void forEachSlice(const Filter& filter, const Rating& rating, F&& fcn) const
+    {
+        const auto last{std::min<std::size_t>(m_buckets.size(),filter.toYear < FirstYear ? 0 : bucket(filter.toYear)+1)};
+        for(auto b{bucket(filter.fromYear)}; b<last; ++b)
+        {
+            const auto& ids{m_buckets[b]};
+            const auto first{std::partition_point(ids.begin(),ids.end(),[&](MovieId id){ return rating(id) > filter.maxRating; })};
+            const auto end{std::partition_point(first,ids.end(),[&](MovieId id){ return rating(id) >= filter.minRating; })};
+            if(first != end)
+                fcn(ids.data()+(first-ids.begin()),ids.data()+(end-ids.begin()));
+        }
+    }
+};
@@ -0,0 +1,1014 @@
+#include "Bench.h"
+#include "BradleyTerry.h"
+#include "Allocations.h"
+#include "CatalogLoader.h"
+#include "Completions.h"
+#include "FlatMap.h"
+#include "IndexList.h"
+#include "Life.h"
+#include "List.h"
+#include "Plot.h"
+#include "Profiler.h"
+#include "Records.h"
+#include "Recommender.h"
+#include "ShardedCatalog.h"
+#include "UnrolledList.h"
+#include "Utils.h"
+#include "Ranking.h"
+#include "RatingClient.h"
+#include "RatingHistory.h"
+#include "RatingServer.h"
+#include "TitlePool.h"
+#include "YearIndex.h"
+#include <filesystem>
+#include <cmath>
+#include <cstdlib>
+#include <forward_list>
+#include <malloc.h>
+#include <optional>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    constexpr auto CatalogSize{100'000u};
+    constexpr auto SessionSize{2'000u};
+    constexpr auto DatasetSize{200'000u};
+
+    // Deterministic catalog resembling movies.txt: a few words per title, years 1920-2024, ratings around 1000.
+    std::vector<Records::Movie> generateCatalog(std::size_t size)
+    {
+        constexpr std::string_view Words[]{"The","Last","Night","of","Return","Dark","Star","Love","City","King",
+                                           "Man","House","Blue","War","Story","Lost","Dead","Summer","Ghost","Road","Love, Actually","\"Quoted\""};
+        std::mt19937 rng{7};
+        std::vector<Records::Movie> catalog(size);
+        for(auto& movie : catalog)
+        {
+            const auto words{2+rng()%4};
+            for(auto i{0u}; i<words; ++i)
+                movie.name.append(i ? " " : "").append(Words[rng()%std::size(Words)]);
+            movie.year = 1920+rng()%105;
+            movie.rating = 900.0+rng()%20000/100.0;
+        }
+        return catalog;
+    }
+
+    void dataset()
+    {
+        const auto catalog{generateCatalog(DatasetSize)};
+        const auto fileName{(std::filesystem::temp_directory_path()/"ratemovies-bench-catalog.txt").string()};
+        std::filesystem::remove(fileName);
+        Records::serializeToFile(fileName,catalog);
+
+        std::vector<std::string> lines;
+        for(const auto& movie : catalog)
+            lines.push_back(Records::serialize(movie));
+
+        Bench::print(Bench::run("Records::load<Movie> catalog file",[&fileName]{
+            std::size_t count{0};
+            auto file{std::fstream{fileName,std::ios_base::in}};
+            Records::load<Records::Movie>(file,[&count](Records::Movie movie){
+                count += movie.year;
+            });
+            Bench::doNotOptimize(count);
+            return DatasetSize;
+        }));
+        Bench::print(Bench::run("CatalogLoader first chunk visible",[&fileName]{
+            CatalogLoader loader{fileName};
+            while(loader.snapshot()->chunks.empty() && !loader.snapshot()->done)
+                std::this_thread::yield();
+            Bench::doNotOptimize(loader.snapshot()->rows);
+            return 1;
+        }));
+        Bench::print(Bench::run("CatalogLoader full load",[&fileName]{
+            CatalogLoader loader{fileName};
+            loader.wait();
+            Bench::doNotOptimize(loader.snapshot()->rows);
+            return 1;
+        }));
+        Bench::print(Bench::run("Records::encodeText record",[&catalog]{
+            std::string buffer;
+            for(const auto& movie : catalog)
+            {
+                buffer.clear();
+                Records::encodeText(movie,buffer);
+                Bench::doNotOptimize(buffer.data());
+            }
+            return catalog.size();
+        }));
+        std::string binary;
+        for(const auto& movie : catalog)
+            Records::encodeBinary(movie,binary);
+        Bench::print(Bench::run("Records::encodeBinary record",[&catalog]{
+            std::string buffer;
+            for(const auto& movie : catalog)
+            {
+                buffer.clear();
+                Records::encodeBinary(movie,buffer);
+                Bench::doNotOptimize(buffer.data());
+            }
+            return catalog.size();
+        }));
+        Bench::print(Bench::run("Records::decodeBinary record",[&binary]{
+            std::size_t count{0};
+            std::string_view in{binary};
+            while(const auto movie{Records::decodeBinary<Records::Movie>(in)})
+                count += movie->year;
+            Bench::doNotOptimize(count);
+            return DatasetSize;
+        }));
+        Bench::print(Bench::run("Utils::Split catalog line",[&lines]{
+            std::size_t count{0};
+            for(const auto& line : lines)
+                for(const auto token : Utils::Split{line})
+                    count += token.size();
+            Bench::doNotOptimize(count);
+            return lines.size();
+        }));
+        Bench::print(Bench::run("Utils::CsvScanner catalog line",[&lines]{
+            std::size_t count{0};
+            std::string scratch;
+            for(const auto& line : lines)
+            {
+                scratch = line;
+                Utils::CsvScanner scanner{scratch};
+                while(const auto field{scanner.next()})
+                    count += field->size();
+            }
+            Bench::doNotOptimize(count);
+            return lines.size();
+        }));
+        Bench::print(Bench::run("Utils::stringEquals title search",[&catalog]{
+            std::size_t matches{0};
+            for(const auto& movie : catalog)
+                matches += Utils::stringEquals(movie.name,"night");
+            Bench::doNotOptimize(matches);
+            return catalog.size();
+        }));
+        Bench::print(Bench::run("Utils::computeElo random pairs",[&catalog]{
+            std::mt19937 rng{11};
+            double sum{0};
+            for(auto i{0u}; i<SessionSize; ++i)
+            {
+                const auto& a{catalog[rng()%catalog.size()]};
+                const auto& b{catalog[rng()%catalog.size()]};
+                const auto [ra,rb]{Utils::computeElo(a.rating,b.rating,rng()&1)};
+                sum += ra-rb;
+            }
+            Bench::doNotOptimize(sum);
+            return SessionSize;
+        }));
+        std::filesystem::remove(fileName);
+    }
+
+    // write(2) calls made by this process so far; -1 where /proc is unavailable.
+    long long writeSyscalls()
+    {
+        auto io{std::fstream{"/proc/self/io",std::ios_base::in}};
+        std::string key;
+        long long value;
+        while(io >> key >> value)
+            if(key == "syscw:")
+                return value;
+        return -1;
+    }
+
+    // The catalog written at exit: as before through fstream with one stringstream and std::endl per record, then through FileWriter.
+    void shutdown()
+    {
+        constexpr auto ShutdownSize{5'000'000u};
+        const auto catalog{generateCatalog(ShutdownSize)};
+        const auto fileName{(std::filesystem::temp_directory_path()/"ratemovies-bench-shutdown.txt").string()};
+        const auto measure{[](const std::string& name, auto&& fcn){
+            const auto syscalls{writeSyscalls()};
+            Bench::print(Bench::run(name,fcn,std::chrono::milliseconds{1}));
+            std::cout << "    write syscalls: " << writeSyscalls()-syscalls << std::endl;
+        }};
+        measure("shutdown 5M movies fstream+endl (per movie)",[&]{
+            std::filesystem::remove(fileName);
+            auto file{std::fstream{fileName,std::ios_base::app}};
+            for(const auto& movie : catalog)
+            {
+                std::stringstream ss;
+                ss << movie.rating << "," << movie.name << "," << movie.year << std::endl;
+                file << ss.str();
+            }
+            file.close();
+            return ShutdownSize;
+        });
+        measure("shutdown 5M movies FileWriter (per movie)",[&]{
+            Records::serializeToFile(fileName,catalog);
+            return ShutdownSize;
+        });
+        std::filesystem::remove(fileName);
+    }
+
+    void completions()
+    {
+        const auto catalog{generateCatalog(DatasetSize)};
+        std::vector<double> ratings;
+        for(const auto& movie : catalog)
+            ratings.push_back(movie.rating);
+        const auto title{[&catalog](MovieId id){ return std::string_view{catalog[id].name}; }};
+        const auto rating{[&ratings](MovieId id){ return ratings[id]; }};
+        Completions index;
+        index.rebuild(catalog.size(),title,rating);
+
+        Bench::print(Bench::run("Completions top 5 for \"The Last\"",[&]{
+            Bench::doNotOptimize(index.top("The Last",5,title,rating).data());
+            return 1;
+        }));
+        Bench::print(Bench::run("prefix scan + partial_sort top 5 (no index)",[&]{
+            std::vector<MovieId> matches;
+            for(MovieId id=0; id<catalog.size(); ++id)
+                if(catalog[id].name.starts_with("The Last"))
+                    matches.push_back(id);
+            const auto k{std::min<std::size_t>(5,matches.size())};
+            std::partial_sort(matches.begin(),matches.begin()+k,matches.end(),[&](MovieId a, MovieId b){ return ratings[a] > ratings[b]; });
+            Bench::doNotOptimize(matches.data());
+            return 1;
+        }));
+        Bench::print(Bench::run("Completions rating update",[&]{
+            std::mt19937 rng{13};
+            for(auto i{0u}; i<SessionSize; ++i)
+            {
+                const auto id{static_cast<MovieId>(rng()%catalog.size())};
+                ratings[id] += 1.0;
+                index.update(id,ratings[id]);
+            }
+            return SessionSize;
+        }));
+    }
+
+    // UTF-8 titles must sort the same way in the packed keys and in the prefix probes, or ASCII prefixes stop matching.
+    bool completionsNonAscii()
+    {
+        std::vector<std::string> titles{"Abyss","Accattone"};
+        for(auto i{0}; i<10; ++i)
+            titles.push_back("A\xc3\xa9lie "+std::to_string(i));
+        const auto title{[&titles](MovieId id){ return std::string_view{titles[id]}; }};
+        const auto rating{[](MovieId id){ return 1000.0+id; }};
+        Completions index;
+        index.rebuild(titles.size(),title,rating);
+        const auto found{[&](std::string_view prefix){ return index.top(prefix,5,title,rating).size(); }};
+        const auto ok{found("Ab") == 1 && found("acc") == 1 && found("A\xc3\xa9") == 5 && found("A") == 5};
+        std::cout << "Completions over non-ASCII titles: " << (ok ? "ok" : "FAILED") << std::endl;
+        return ok;
+    }
+
+    // Allocated bytes, including the large blocks malloc serves with mmap.
+    std::size_t heapInUse()
+    {
+        const auto info{mallinfo2()};
+        return info.uordblks+info.hblkhd;
+    }
+
+    // Catalog title storage in heap bytes per movie, std::string per row against the interned pool.
+    void titleStorage()
+    {
+        constexpr auto Copies{10'000u};
+        std::vector<std::string> titles;
+        auto file{std::fstream{"movies.txt",std::ios_base::in}};
+        Records::load<Records::Movie>(file,[&titles](Records::Movie movie){ titles.push_back(std::move(movie.name)); });
+        if(titles.empty())
+        {
+            std::cout << "title storage: movies.txt not found, skipped" << std::endl;
+            return;
+        }
+        struct StringTitle { std::string name; int year; };
+        struct PooledTitle { TitlePool::Handle name; int year; };
+        const auto rows{titles.size()*Copies};
+        const auto report{[rows](const char* name, std::size_t bytes){
+            std::cout << std::left << std::setw(48) << name << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+                      << static_cast<double>(bytes)/rows << " bytes/movie" << std::endl;
+        }};
+        // distinct=false repeats every title verbatim; true appends the copy number so nothing can be shared.
+        for(const auto distinct : {false,true})
+        {
+            const auto title{[&](std::size_t row){
+                const auto& base{titles[row%titles.size()]};
+                return distinct ? base+" #"+std::to_string(row/titles.size()) : base;
+            }};
+            std::cout << "movies.txt x" << Copies << (distinct ? " with distinct titles" : "") << ", " << rows << " movies:" << std::endl;
+            {
+                const auto before{heapInUse()};
+                std::vector<StringTitle> movies;
+                movies.reserve(rows);
+                for(std::size_t row=0; row<rows; ++row)
+                    movies.push_back({title(row),2000});
+                report("  std::string per movie",heapInUse()-before);
+            }
+            {
+                const auto before{heapInUse()};
+                TitlePool pool;
+                std::vector<PooledTitle> movies;
+                movies.reserve(rows);
+                for(std::size_t row=0; row<rows; ++row)
+                    movies.push_back({pool.intern(title(row)),2000});
+                report("  TitlePool handle per movie",heapInUse()-before);
+            }
+        }
+        TitlePool pool;
+        std::vector<TitlePool::Handle> handles;
+        for(const auto& title : titles)
+            handles.push_back(pool.intern(title));
+        Bench::print(Bench::run("TitlePool intern existing title",[&]{
+            for(const auto& title : titles)
+                Bench::doNotOptimize(pool.intern(title));
+            return titles.size();
+        }));
+        Bench::print(Bench::run("TitlePool decode title",[&]{
+            std::size_t length{0};
+            for(const auto handle : handles)
+                length += pool[handle].size();
+            Bench::doNotOptimize(length);
+            return handles.size();
+        }));
+    }
+
+    void allocations()
+    {
+        const auto wasEnabled{Allocations::enabled()};
+        const auto churn{[]{
+            for(auto i{0}; i<1000; ++i)
+            {
+                auto p{std::make_unique<std::array<char,64>>()};
+                Bench::doNotOptimize(p.get());
+            }
+            return 1000;
+        }};
+        Allocations::enable(false);
+        Bench::print(Bench::run("new+delete 64 B, accounting off",churn));
+        Allocations::enable(true);
+        Bench::print(Bench::run("new+delete 64 B, accounting on",churn));
+        Bench::print(Bench::run("new+delete 64 B, accounting on, tagged scope",[&churn]{
+            ALLOCATION_SCOPE("bench.churn");
+            return churn();
+        }));
+        Allocations::enable(wasEnabled);
+    }
+
+    void ratingServer()
+    {
+        RatingServer server{generateCatalog(DatasetSize)};
+        for(const auto threads : {1u,4u})
+        {
+            Bench::print(Bench::run("RatingServer::rate, "+std::to_string(threads)+" threads",[&server,threads]{
+                constexpr auto PerThread{20'000u};
+                std::vector<std::thread> workers;
+                for(auto t{0u}; t<threads; ++t)
+                    workers.emplace_back([&server,t]{
+                        std::mt19937 rng{t};
+                        for(auto i{0u}; i<PerThread; ++i)
+                        {
+                            const auto first{static_cast<MovieId>(rng()%DatasetSize)};
+                            server.rate(first,(first+1+rng()%(DatasetSize-1))%DatasetSize,i & 1);
+                        }
+                    });
+                for(auto& worker : workers)
+                    worker.join();
+                return threads*PerThread;
+            }));
+        }
+        const auto path{(std::filesystem::temp_directory_path()/"ratemovies-bench.sock").string()};
+        if(!server.listen(path))
+        {
+            std::cout << "rating server: could not listen on " << path << ", skipped" << std::endl;
+            return;
+        }
+        std::atomic<bool> stop{false};
+        std::thread serving{[&server,&stop]{ server.run(stop); }};
+        for(const auto clients : {1u,2u,4u})
+        {
+            const auto result{LoadGenerator::run(path,clients,std::chrono::milliseconds{300})};
+            std::cout << std::left << std::setw(48) << ("RatingServer socket, "+std::to_string(clients)+" clients") << std::right
+                      << std::setw(12) << std::fixed << std::setprecision(0) << result.updates/result.seconds << " updates/s"
+                      << std::setprecision(1) << "  p50 " << result.p50Us << " us, p99 " << result.p99Us << " us" << std::endl;
+        }
+        stop = true;
+        serving.join();
+    }
+
+    // Comparisons between random pairs decided by hidden Bradley-Terry strengths; fills truth with them on the Elo scale.
+    std::vector<Records::Comparison> generateComparisons(std::size_t movies, std::size_t count, std::vector<double>& truth)
+    {
+        std::mt19937 rng{11};
+        std::normal_distribution<double> spread{1000.0,150.0};
+        truth.resize(movies);
+        for(auto& rating : truth)
+            rating = spread(rng);
+        std::vector<Records::Comparison> comparisons;
+        comparisons.reserve(count);
+        std::uniform_real_distribution<double> coin{0.0,1.0};
+        while(comparisons.size() < count)
+        {
+            const auto a{static_cast<MovieId>(rng()%movies)};
+            const auto b{static_cast<MovieId>(rng()%movies)};
+            if(a == b)
+                continue;
+            const auto aWins{coin(rng) < 1.0/(1.0+std::pow(10.0,(truth[b]-truth[a])/400.0))};
+            comparisons.push_back(aWins ? Records::Comparison{a,b} : Records::Comparison{b,a});
+        }
+        return comparisons;
+    }
+
+    // Spread of fitted minus true rating, after removing the mean offset.
+    double ratingError(const BradleyTerry& model, const std::vector<double>& truth)
+    {
+        double offset{0};
+        for(MovieId id=0; id<truth.size(); ++id)
+            offset += model.rating(id)-truth[id];
+        offset /= truth.size();
+        double sum{0};
+        for(MovieId id=0; id<truth.size(); ++id)
+            sum += std::pow(model.rating(id)-truth[id]-offset,2);
+        return std::sqrt(sum/truth.size());
+    }
+
+    void bradleyTerry()
+    {
+        std::vector<double> truth;
+        {
+            const auto comparisons{generateComparisons(100'000,5'000'000,truth)};
+            BradleyTerry model{truth.size(),comparisons};
+            BradleyTerry::Result result;
+            Bench::print(Bench::run("BradleyTerry fit to 1e-6, 100k movies, 5M comparisons",[&]{
+                model = BradleyTerry{truth.size(),comparisons};
+                result = model.fit();
+                return 1;
+            },std::chrono::milliseconds{1}));
+            std::cout << "    " << result.iterations << " iterations, " << (result.converged ? "converged" : "not converged")
+                      << ", rating error " << std::setprecision(1) << ratingError(model,truth) << " Elo" << std::endl;
+        }
+        constexpr auto Movies{1'000'000u};
+        constexpr auto Comparisons{50'000'000u};
+        constexpr auto Iterations{10u};
+        const auto comparisons{generateComparisons(Movies,Comparisons,truth)};
+        Bench::print(Bench::run("Elo sequential pass, 50M comparisons",[&]{
+            std::vector<double> ratings(Movies,1000.0);
+            for(const auto& comparison : comparisons)
+                std::tie(ratings[comparison.winner],ratings[comparison.loser]) = Utils::computeElo(ratings[comparison.winner],ratings[comparison.loser],true);
+            Bench::doNotOptimize(ratings.data());
+            return Comparisons;
+        },std::chrono::milliseconds{1}));
+        std::optional<BradleyTerry> model;
+        Bench::print(Bench::run("BradleyTerry CSR build, 1M movies, 50M comparisons",[&]{
+            model.emplace(Movies,comparisons);
+            return Comparisons;
+        },std::chrono::milliseconds{1}));
+        for(const auto threads : {1u,4u})
+        {
+            BradleyTerry::Options options;
+            options.maxIterations = Iterations;
+            options.threads = threads;
+            Bench::print(Bench::run("BradleyTerry iteration, 1M/50M, "+std::to_string(threads)+" threads",[&]{
+                return model->fit(options).iterations;
+            },std::chrono::milliseconds{1}));
+        }
+    }
+
+    // A year of votes replayed through Elo: 5M comparisons among 100k movies, one every 6 seconds on average.
+    void ratingHistory()
+    {
+        constexpr auto Movies{100'000u};
+        constexpr auto Votes{5'000'000u};
+        constexpr RatingHistory::Time Start{1'700'000'000};
+        constexpr RatingHistory::Time Day{24*60*60};
+        std::vector<double> truth;
+        const auto comparisons{generateComparisons(Movies,Votes,truth)};
+        std::mt19937 rng{13};
+        std::exponential_distribution<double> gap{1.0/6.0};
+        std::vector<RatingHistory::Time> times(Votes);
+        auto time{static_cast<double>(Start)};
+        for(auto& t : times)
+            t = static_cast<RatingHistory::Time>(time += gap(rng));
+        const auto end{times.back()};
+
+        RatingHistory history;
+        Bench::print(Bench::run("RatingHistory append, 10M points",[&]{
+            history = RatingHistory{};
+            std::vector<double> ratings(Movies,1000.0);
+            for(std::size_t i=0; i<Votes; ++i)
+            {
+                const auto [winner,loser]{comparisons[i]};
+                std::tie(ratings[winner],ratings[loser]) = Utils::computeElo(ratings[winner],ratings[loser],true);
+                history.append(winner,times[i],ratings[winner]);
+                history.append(loser,times[i],ratings[loser]);
+            }
+            return 2*Votes;
+        },std::chrono::milliseconds{1}));
+        std::cout << "    " << history.points() << " points in " << Utils::storage(history.bytes()) << ", "
+                  << std::setprecision(2) << static_cast<double>(history.bytes())/history.points() << " bytes per point against "
+                  << sizeof(RatingHistory::Point) << " uncompressed" << std::endl;
+
+        Bench::print(Bench::run("RatingHistory rating at a random time",[&]{
+            const auto id{static_cast<MovieId>(rng()%Movies)};
+            Bench::doNotOptimize(history.at(id,Start+static_cast<RatingHistory::Time>(rng()%(end-Start))));
+            return 1;
+        }));
+        Bench::print(Bench::run("RatingHistory one movie over the last 30 days",[&]{
+            const auto id{static_cast<MovieId>(rng()%Movies)};
+            double sum{0};
+            history.forEach(id,end-30*Day,end,[&sum](RatingHistory::Time, double rating){ sum += rating; });
+            Bench::doNotOptimize(sum);
+            return 1;
+        }));
+        Bench::print(Bench::run("RatingHistory biggest movers of the last 7 days",[&]{
+            Bench::doNotOptimize(history.movers(end-7*Day,10));
+            return 1;
+        }));
+        // The same answer from decoding every point, as a store without chunk headers would have to.
+        Bench::print(Bench::run("RatingHistory movers by decoding every point",[&]{
+            std::vector<std::pair<double,MovieId>> changes;
+            for(MovieId id=0; id<Movies; ++id)
+            {
+                std::optional<double> start;
+                double last{0};
+                history.forEach(id,Start,end,[&](RatingHistory::Time time, double rating){
+                    if(time <= end-7*Day || !start)
+                        start = rating;
+                    last = rating;
+                });
+                if(start && last != *start)
+                    changes.push_back({-std::abs(last-*start),id});
+            }
+            std::partial_sort(changes.begin(),changes.begin()+std::min<std::size_t>(10,changes.size()),changes.end());
+            Bench::doNotOptimize(changes.data());
+            return 1;
+        }));
+    }
+
+    // A million-point random walk drawn to a 200-column window, the size of the graph view on a wide terminal.
+    void plot()
+    {
+        constexpr std::size_t Points{1'000'000};
+        std::mt19937 rng{17};
+        std::normal_distribution<double> step{0.0,1.0};
+        Plot::Series series;
+        Bench::print(Bench::run("Plot append, 1M points",[&]{
+            series.clear();
+            double y{0};
+            for(std::size_t i=0; i<Points; ++i)
+                series.append(static_cast<double>(i),y += step(rng));
+            return Points;
+        },std::chrono::milliseconds{1}));
+        const auto [low,high]{series.extent(0,series.size())};
+        Bench::print(Bench::run("Plot extent of a random range",[&]{
+            const auto first{rng()%Points};
+            const auto last{first+1+rng()%(Points-first)};
+            Bench::doNotOptimize(series.extent(first,last));
+            return 1;
+        }));
+        Bench::print(Bench::run("Plot extent of a random range by scanning",[&]{
+            const auto first{rng()%Points};
+            const auto last{first+1+rng()%(Points-first)};
+            auto extent{std::pair{series[first].y,series[first].y}};
+            for(auto i{first}; i<last; ++i)
+                extent = {std::min(extent.first,series[i].y),std::max(extent.second,series[i].y)};
+            Bench::doNotOptimize(extent);
+            return 1;
+        }));
+
+        Plot::Canvas canvas;
+        canvas.resize(200,40);
+        Plot::Plotter plotter;
+        const auto frame{[&](Plot::Method method){
+            canvas.clear();
+            plotter.draw(series,method,canvas,series.front().x,series.back().x,low,high);
+            for(int row=0; row<canvas.rows(); ++row)
+                Bench::doNotOptimize(canvas.row(row,true).data());
+            return 1;
+        }};
+        Bench::print(Bench::run("Plot min-max frame, 1M points",[&]{ return frame(Plot::Method::MinMax); }));
+        Bench::print(Bench::run("Plot LTTB frame, 1M points, reduction reused",[&]{ return frame(Plot::Method::Lttb); }));
+        // Appending invalidates the reduction, as the live series in the graph view do every frame.
+        auto x{series.back().x};
+        Bench::print(Bench::run("Plot LTTB frame after an append",[&]{
+            series.append(++x,series.back().y+step(rng));
+            return frame(Plot::Method::Lttb);
+        }));
+        Bench::print(Bench::run("Plot min-max frame after an append",[&]{
+            series.append(++x,series.back().y+step(rng));
+            return frame(Plot::Method::MinMax);
+        }));
+    }
+
+    void yearIndex()
+    {
+        const auto catalog{generateCatalog(DatasetSize)};
+        std::vector<double> ratings;
+        for(const auto& movie : catalog)
+            ratings.push_back(movie.rating);
+        const auto year{[&catalog](MovieId id){ return catalog[id].year; }};
+        const auto rating{[&ratings](MovieId id){ return ratings[id]; }};
+        Ranking ranking;
+        ranking.rebuild(catalog.size(),rating);
+        YearIndex index;
+        index.rebuild(catalog.size(),year,rating);
+        const YearIndex::Filter seventies{1970,1979,1050.0};
+
+        Bench::print(Bench::run("YearIndex first page of 1970-1979 >=1050",[&]{
+            auto matches{index.query(seventies,rating)};
+            MovieId id;
+            for(auto row{0}; row<40 && matches.next(id); ++row)
+                Bench::doNotOptimize(id);
+            return 1;
+        }));
+        Bench::print(Bench::run("YearIndex count 1970-1979 >=1050",[&]{
+            Bench::doNotOptimize(index.count(seventies,rating));
+            return 1;
+        }));
+        Bench::print(Bench::run("filter ranking into a vector (no index)",[&]{
+            std::vector<MovieId> matches;
+            for(const auto id : ranking)
+                if(catalog[id].year >= seventies.fromYear && catalog[id].year <= seventies.toYear && ratings[id] >= seventies.minRating)
+                    matches.push_back(id);
+            Bench::doNotOptimize(matches.data());
+            return 1;
+        }));
+        Bench::print(Bench::run("YearIndex rating update",[&]{
+            std::mt19937 rng{13};
+            for(auto i{0u}; i<SessionSize; ++i)
+            {
+                const auto id{static_cast<MovieId>(rng()%catalog.size())};
+                const auto old{ratings[id]};
+                ratings[id] += 1.0;
+                index.update(id,old,rating);
+            }
+            return SessionSize;
+        }));
+    }
+
+    void archive()
+    {
+        constexpr std::size_t Budget{4 << 20};
+        const auto directory{std::filesystem::temp_directory_path()/"ratemovies-bench-archive"};
+        const auto catalog{generateCatalog(DatasetSize)};
+        ShardedCatalog::build(catalog,directory);
+        ShardedCatalog archive{directory,Budget};
+        const auto report{[&archive](const std::string& name, auto&& fcn){
+            const auto before{archive.stats()};
+            const auto result{Bench::run(name,fcn)};
+            Bench::print(result);
+            const auto& after{archive.stats()};
+            std::cout << "    per op: " << std::setprecision(1) << static_cast<double>(after.misses-before.misses)/result.ops << " shard misses, "
+                      << static_cast<double>(after.hits-before.hits)/result.ops << " hits of " << archive.shards() << " shards" << std::endl;
+        }};
+        report("ShardedCatalog browse page of 40",[&archive]{
+            std::size_t count{0};
+            archive.forEachInRange(DatasetSize/2,40,[&count](std::size_t, const Records::Movie& movie){ count += movie.year; });
+            Bench::doNotOptimize(count);
+            return 1;
+        });
+        report("ShardedCatalog search \"night\"",[&archive]{
+            std::size_t count{0};
+            archive.search("night",[&count](std::size_t, const Records::Movie&){ ++count; });
+            Bench::doNotOptimize(count);
+            return 1;
+        });
+        report("ShardedCatalog search \"xyzzy\" (bloom skips)",[&archive]{
+            std::size_t count{0};
+            archive.search("xyzzy",[&count](std::size_t, const Records::Movie&){ ++count; });
+            Bench::doNotOptimize(count);
+            return 1;
+        });
+        report("ShardedCatalog recommend top 10",[&archive]{
+            Recommender recommender;
+            std::vector<Recommender::Candidate> heap;
+            archive.forEachWhile([&](double ratingMax){ return heap.size() < 10 || recommender.bound(ratingMax) > heap.front().score; },
+                                 [&](std::size_t rank, const Records::Movie& movie){
+                Recommender::offer(heap,10,recommender.score(static_cast<MovieId>(rank),movie.rating,nullptr,movie.year,2024));
+            });
+            Bench::doNotOptimize(heap.data());
+            return 1;
+        });
+        std::filesystem::remove_all(directory);
+    }
+
+    void life()
+    {
+        constexpr auto Height{60};
+        constexpr auto Width{200};
+        Life life{Height,Width};
+        Bench::print(Bench::run("Life step 200x60 (per cell)",[&life]{
+            Bench::doNotOptimize(life.step());
+            return Height*Width;
+        }));
+    }
+
+    std::vector<MovieId> sessionIds()
+    {
+        std::mt19937 rng{42};
+        std::vector<MovieId> ids(SessionSize);
+        for(auto& id : ids)
+            id = rng() % CatalogSize;
+        return ids;
+    }
+
+    template<class Map>
+    void sessionDiffs(const std::string& name)
+    {
+        const auto ids{sessionIds()};
+        Map map;
+        for(const auto id : ids)
+            map[id] += 16.0;
+
+        Bench::print(Bench::run(name+" insert",[&ids]{
+            Map fresh;
+            for(const auto id : ids)
+                fresh[id] += 16.0;
+            Bench::doNotOptimize(fresh.size());
+            return ids.size();
+        }));
+        Bench::print(Bench::run(name+" lookup",[&ids,&map]{
+            double sum{0};
+            for(const auto id : ids)
+            {
+                if constexpr (std::is_same<Map,FlatMap<MovieId,double>>())
+                    sum += *map.find(id);
+                else
+                    sum += map.find(id)->second;
+            }
+            Bench::doNotOptimize(sum);
+            return ids.size();
+        }));
+        Bench::print(Bench::run(name+" iterate",[&map]{
+            double best{0};
+            for(const auto& [id,diff] : map)
+                best = std::max(best,diff);
+            Bench::doNotOptimize(best);
+            return map.size();
+        }));
+    }
+
+    void ratingCache()
+    {
+        std::vector<std::string> names;
+        for(auto i{0u}; i<CatalogSize; ++i)
+            names.push_back("Some movie title number "+std::to_string(i));
+
+        std::unordered_map<std::string,int> byName;
+        std::vector<double> byId(CatalogSize);
+        for(auto i{0u}; i<CatalogSize; ++i)
+        {
+            byName[names[i]] = 1000+i%100;
+            byId[i] = 1000+i%100;
+        }
+
+        Bench::print(Bench::run("ratingCache unordered_map<string> restore",[&]{
+            double sum{0};
+            for(const auto& name : names)
+                if(const auto it{byName.find(name)}; it != byName.end())
+                    sum += it->second;
+            Bench::doNotOptimize(sum);
+            return names.size();
+        }));
+        Bench::print(Bench::run("ratingCache dense vector<double> restore",[&]{
+            double sum{0};
+            for(MovieId id=0; id<byId.size(); ++id)
+                sum += byId[id];
+            Bench::doNotOptimize(sum);
+            return byId.size();
+        }));
+    }
+
+    constexpr auto ListSize{10'000};
+
+    void listOperations()
+    {
+        Bench::print(Bench::run("List append+clear",[]{
+            List<int> list{0};
+            for(int i=1; i<ListSize; ++i)
+                list.append(i);
+            list.clear();
+            return ListSize;
+        }));
+        Bench::print(Bench::run("forward_list append+clear",[]{
+            std::forward_list<int> list{0};
+            auto tail{list.begin()};
+            for(int i=1; i<ListSize; ++i)
+                tail = list.insert_after(tail,i);
+            list.clear();
+            return ListSize;
+        }));
+        Bench::print(Bench::run("vector append+clear",[]{
+            std::vector<int> list{0};
+            for(int i=1; i<ListSize; ++i)
+                list.push_back(i);
+            list.clear();
+            return ListSize;
+        }));
+
+        // remove near the front and append again, the pattern of the List view
+        constexpr auto Churn{1'000};
+        List<int> list{0};
+        std::forward_list<int> forwardList{0};
+        auto tail{forwardList.begin()};
+        std::vector<int> vector{0};
+        for(int i=1; i<ListSize; ++i)
+        {
+            list.append(i);
+            tail = forwardList.insert_after(tail,i);
+            vector.push_back(i);
+        }
+        Bench::print(Bench::run("List remove(2)+append churn",[&list]{
+            for(int i=0; i<Churn; ++i)
+            {
+                list.remove(2);
+                list.append(i);
+            }
+            return Churn;
+        }));
+        Bench::print(Bench::run("forward_list erase(2)+append churn",[&forwardList,&tail]{
+            for(int i=0; i<Churn; ++i)
+            {
+                forwardList.erase_after(std::next(forwardList.begin()));
+                tail = forwardList.insert_after(tail,i);
+            }
+            return Churn;
+        }));
+        Bench::print(Bench::run("vector erase(2)+append churn",[&vector]{
+            for(int i=0; i<Churn; ++i)
+            {
+                vector.erase(vector.begin()+2);
+                vector.push_back(i);
+            }
+            return Churn;
+        }));
+    }
+
+    // Same workload for each List<T>-compatible container
+    template<class L>
+    void listSuite(const std::string& name)
+    {
+        constexpr auto Size{100'000};
+        constexpr auto RemoveSize{5'000};
+        std::mt19937 rng{7};
+
+        Bench::print(Bench::run(name+" append",[]{
+            L list{0};
+            for(int i=1; i<Size; ++i)
+                list.append(i);
+            return Size;
+        }));
+
+        // churn first so nodes are no longer laid out in append order
+        L list{0};
+        for(int i=1; i<Size; ++i)
+            list.append(i);
+        for(int i=0; i<Size/10; ++i)
+        {
+            list.remove(rng()%1000);
+            list.append(i);
+        }
+        Bench::print(Bench::run(name+" traversal",[&list]{
+            long long sum{0};
+            list.forEach([&sum](int value){ sum += value; });
+            Bench::doNotOptimize(sum);
+            return list.size();
+        }));
+
+        L small{0};
+        for(int i=1; i<RemoveSize; ++i)
+            small.append(i);
+        Bench::print(Bench::run(name+" random remove",[&small,&rng]{
+            small.remove(rng()%small.size());
+            small.append(0);
+            return 1;
+        }));
+    }
+
+    void queues()
+    {
+        constexpr auto Window{512};
+        constexpr auto Adds{100'000};
+        Bench::print(Bench::run("Queue ring buffer add (window 512)",[]{
+            Utils::Queue<int> queue{Window};
+            for(int i=0; i<Adds; ++i)
+                queue.add(i);
+            Bench::doNotOptimize(queue.get(0));
+            return Adds;
+        }));
+        Bench::print(Bench::run("vector push+erase(begin) add (window 512)",[]{
+            std::vector<int> buf;
+            for(int i=0; i<Adds; ++i)
+            {
+                buf.push_back(i);
+                if(buf.size()>Window)
+                    buf.erase(buf.begin());
+            }
+            Bench::doNotOptimize(buf.front());
+            return Adds;
+        }));
+    }
+
+    // Producers stream 0..n-1 each into a ConcurrentQueue; false if the consumer saw any element lost or repeated.
+    bool concurrentQueue()
+    {
+        constexpr auto Adds{100'000};
+        auto ok{true};
+        for(const auto producers : {1,4})
+            Bench::print(Bench::run("ConcurrentQueue "+std::to_string(producers)+" producer(s) -> 1 consumer",[producers,&ok]{
+                constexpr auto Window{1024};
+                Utils::ConcurrentQueue<int> queue{Window};
+                std::vector<std::thread> threads;
+                for(int p=0; p<producers; ++p)
+                    threads.emplace_back([&queue,producers]{
+                        for(int i=0; i<Adds/producers; ++i)
+                            while(!queue.add(i))
+                                std::this_thread::yield();
+                    });
+                long long sum{0};
+                const auto total{Adds/producers*producers};
+                for(int received=0; received<total;)
+                    if(const auto count{queue.update()})
+                    {
+                        // The ring holds no more than the window, so everything that arrived is still in it.
+                        for(auto i{queue.size()-count}; i<queue.size(); ++i)
+                            sum += queue.get(i);
+                        received += static_cast<int>(count);
+                    }
+                    else
+                        std::this_thread::yield();
+                for(auto& thread : threads)
+                    thread.join();
+                const auto each{static_cast<long long>(Adds/producers)};
+                ok = ok && sum == producers*each*(each-1)/2;
+                return total;
+            }));
+        std::cout << "ConcurrentQueue delivers every element once: " << (ok ? "ok" : "FAILED") << std::endl;
+        return ok;
+    }
+
+    void profiler()
+    {
+        constexpr auto Zones{1'000};
+        static const auto zone{Profiler::zone("bench.zone")};
+        Bench::print(Bench::run("Profiler scoped zone incl. collect",[]{
+            for(int i=0; i<Zones; ++i)
+            {
+                const Profiler::Scope scope{zone};
+                Bench::doNotOptimize(i);
+            }
+            Profiler::collect();
+            return Zones;
+        }));
+        Bench::print(Bench::run("Utils::Timer string (previous Life timer)",[]{
+            for(int i=0; i<Zones; ++i)
+            {
+                auto timer{Utils::Timer{}};
+                Bench::doNotOptimize(timer.get());
+            }
+            return Zones;
+        }));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(std::getenv("RATEMOVIES_ALLOC_STATS"))
+        Allocations::enable(true);
+    const std::string jsonFlag{"--json"};
+    if(argc > 1 && (argc != 3 || argv[1] != jsonFlag))
+    {
+        std::cerr << "usage: " << argv[0] << " [--json FILE]" << std::endl;
+        return 2;
+    }
+
+    sessionDiffs<std::unordered_map<MovieId,double>>("sessionDiffs unordered_map");
+    sessionDiffs<FlatMap<MovieId,double>>("sessionDiffs FlatMap");
+    ratingCache();
+    listOperations();
+    listSuite<List<int>>("List");
+    listSuite<UnrolledList<int>>("UnrolledList");
+    listSuite<IndexList<int>>("IndexList");
+    queues();
+    const auto queueOk{concurrentQueue()};
+    profiler();
+    allocations();
+    dataset();
+    shutdown();
+    completions();
+    const auto completionsOk{completionsNonAscii()};
+    titleStorage();
+    yearIndex();
+    ratingServer();
+    bradleyTerry();
+    ratingHistory();
+    plot();
+    archive();
+    life();
+    if(Allocations::enabled())
+        Allocations::report(std::cout);
+    if(argc == 3 && !Bench::writeJson(argv[2]))
+    {
+        std::cerr << "could not write " << argv[2] << std::endl;
+        return 1;
+    }
+    return completionsOk && queueOk ? 0 : 1;
+}
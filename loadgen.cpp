@@ -0,0 +1,30 @@
+#include "RatingClient.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Rates random pairs against a running server with 1, 2, 4, ... clients and reports throughput for each.
+int main(int argc, char** argv)
+{
+    if(argc < 2 || argc > 4)
+    {
+        std::cerr << "usage: " << argv[0] << " SOCKET [MAX_CLIENTS] [SECONDS_PER_STEP]" << std::endl;
+        return 2;
+    }
+    const std::string path{argv[1]};
+    const auto maxClients{argc > 2 ? std::max(1,std::atoi(argv[2])) : 16};
+    const auto seconds{argc > 3 ? std::max(1,std::atoi(argv[3])) : 2};
+    if(RatingClient probe{path}; !probe.good() || probe.size() < 2)
+    {
+        std::cerr << "No rating server with at least two movies at " << path << std::endl;
+        return 1;
+    }
+    std::printf("%8s %14s %14s %10s %10s\n","CLIENTS","UPDATES/S","PER CLIENT","P50 us","P99 us");
+    for(auto clients{1}; clients<=maxClients; clients*=2)
+    {
+        const auto result{LoadGenerator::run(path,clients,std::chrono::seconds{seconds})};
+        const auto rate{result.updates/result.seconds};
+        std::printf("%8zu %14.0f %14.0f %10.1f %10.1f\n",result.clients,rate,rate/clients,result.p50Us,result.p99Us);
+    }
+}
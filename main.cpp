@@ -1,6 +1,123 @@
 #include "Movies.h"
+#include "Allocations.h"
+#include "RatingServer.h"
+#include "Session.h"
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr auto DefaultBudgetMb{64};
+    // Where the local catalog keeps its votes and rating history; the server adds to them.
+    constexpr auto ComparisonsFilename{"comparisons.txt"};
+    constexpr auto HistoryFilename{"history.bin"};
+    // Set to any value to count heap allocations from startup; the tables are printed at exit.
+    constexpr auto AllocationStatsVariable{"RATEMOVIES_ALLOC_STATS"};
+
+    std::atomic<bool> stopServer{false};
+
+    // Serves the catalog until SIGINT or SIGTERM, then writes the shared ratings back to it and records the votes.
+    int serve(const std::string& socketPath, const std::string& catalog)
+    {
+        std::vector<Records::Movie> movies;
+        auto file{std::fstream{catalog,std::ios_base::in}};
+        Records::load<Records::Movie>(file,[&movies](Records::Movie movie){ movies.push_back(std::move(movie)); });
+        if(movies.empty())
+        {
+            std::cerr << "No movies in " << catalog << std::endl;
+            return 1;
+        }
+        RatingServer server{std::move(movies)};
+        if(!server.listen(socketPath))
+        {
+            std::cerr << "Could not listen on " << socketPath << std::endl;
+            return 1;
+        }
+        std::signal(SIGINT,[](int){ stopServer.store(true); });
+        std::signal(SIGTERM,[](int){ stopServer.store(true); });
+        std::cout << "Serving " << server.size() << " movies on " << socketPath << std::endl;
+        server.run(stopServer);
+        std::cout << server.updates() << " ratings applied" << std::endl;
+        if(!server.save(catalog,ComparisonsFilename,HistoryFilename))
+        {
+            std::cerr << "Could not write " << catalog << ", " << ComparisonsFilename << " or " << HistoryFilename << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    int reportAllocations(int exitCode)
+    {
+        if(Allocations::enabled())
+            Allocations::report(std::cout);
+        return exitCode;
+    }
+}
 
 int main(int argc, char* argv[])
 {
-    return Movies().execute();
-}
\ No newline at end of file
+    if(std::getenv(AllocationStatsVariable))
+        Allocations::enable(true);
+    const std::vector<std::string> args(argv+1,argv+argc);
+    if(args.size() == 3 && args[0] == "--build-archive")
+    {
+        ALLOCATION_SCOPE("archive.build");
+        std::vector<Records::Movie> movies;
+        auto file{std::fstream{args[1],std::ios_base::in}};
+        Records::load<Records::Movie>(file,[&movies](Records::Movie movie){ movies.push_back(std::move(movie)); });
+        const auto count{movies.size()};
+        const auto shards{ShardedCatalog::build(std::move(movies),args[2])};
+        std::cout << count << " movies written to " << shards << " shards in " << args[2] << std::endl;
+        return reportAllocations(0);
+    }
+    if(!args.empty() && args[0] == "--archive" && (args.size() == 2 || args.size() == 3))
+    {
+        const auto budgetMb{args.size() == 3 ? std::atoi(args[2].c_str()) : DefaultBudgetMb};
+        if(!ShardedCatalog{args[1],0}.good())
+        {
+            std::cerr << "No archive catalog in " << args[1] << std::endl;
+            return 1;
+        }
+        const auto exitCode{Movies(args[1],static_cast<std::size_t>(std::max(budgetMb,1))*1024*1024).execute()};
+        return reportAllocations(exitCode);
+    }
+    if(!args.empty() && args[0] == "--serve" && (args.size() == 2 || args.size() == 3))
+        return reportAllocations(serve(args[1],args.size() == 3 ? args[2] : "movies.txt"));
+    if(args.size() == 2 && args[0] == "--connect")
+    {
+        auto client{std::make_unique<RatingClient>(args[1])};
+        if(!client->good())
+        {
+            std::cerr << "No rating server at " << args[1] << std::endl;
+            return 1;
+        }
+        const auto exitCode{Movies(std::move(client)).execute()};
+        return reportAllocations(exitCode);
+    }
+    if(args.size() == 2 && (args[0] == "--record" || args[0] == "--replay"))
+    {
+        const auto recording{args[0] == "--record"};
+        if(!(recording ? Session::record(args[1]) : Session::replay(args[1])))
+        {
+            std::cerr << (recording ? "Could not create " : "No recorded session in ") << args[1] << std::endl;
+            return 1;
+        }
+        const auto exitCode{Movies().execute()};
+        if(!Session::finish(std::cout))
+        {
+            std::cerr << "Could not write " << args[1] << std::endl;
+            return 1;
+        }
+        return reportAllocations(exitCode);
+    }
+    if(!args.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--archive DIR [BUDGET_MB] | --build-archive CATALOG DIR | --serve SOCKET [CATALOG] | --connect SOCKET | --record FILE | --replay FILE]" << std::endl;
+        return 2;
+    }
+    const auto exitCode{Movies().execute()};
+    return reportAllocations(exitCode);
+}